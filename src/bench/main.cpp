@@ -0,0 +1,473 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include <chrono>
+#include <print>
+
+#include <argparse/argparse.hpp>
+
+#if defined(_WIN32)
+#include <windows.h>
+// windows.h must come first.
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "common/crypto1.h"
+#include "common/iso14443a_frame.h"
+#include "common/mifare_key_tester.h"
+#include "common/static_nested_solver.h"
+#include "common/tag_emulator.h"
+
+#include "utility.h"
+
+using namespace nfcpp;
+using namespace nfcpp::mifare;
+using namespace nfcpp::static_nested;
+
+namespace {
+
+// Nonces as collect_data would capture them from a static nonce tag, the
+// i-th nonce is prng_successor(nt_1, distances[i]).
+struct Fixture {
+    const char*                  name;
+    std::uint32_t                nuid;
+    std::uint64_t                key;
+    std::uint32_t                nt_1;
+    std::array<std::uint32_t, 2> distances;
+};
+
+constexpr std::array fixtures = {
+    // The common case, two different nonces and a handful of candidates.
+    Fixture{"typical", 0xDEADBEEF, 0xA0A1A2A3A4A5, 0x01200145, {161, 321}},
+    Fixture{"typical-2", 0x9C599B32, 0xD0A758222680, 0x009080A2, {161, 321}},
+    Fixture{"typical-3", 0x4F1A22C3, 0x123456789ABC, 0x01200145, {161, 321}},
+    // Tags whose nested nonce never moves, both nonces are identical and
+    // every state survives the join.
+    Fixture{"identical", 0xDEADBEEF, 0xA0A1A2A3A4A5, 0x01200145, {161, 161}},
+    Fixture{"identical-2", 0x2A8B4C15, 0xFFFFFFFFFFFF, 0x009080A2, {1, 1}},
+};
+
+EncryptedNonce
+encrypt_nonce(std::uint64_t key, std::uint32_t nuid, std::uint32_t nt) {
+    auto cipher = Crypto1State::from_key(key);
+
+    EncryptedNonce ret{nt, 0, 0};
+    for (auto i : std::views::iota(0uz, 4uz)) {
+        auto shift   = 24 - 8 * i;
+        auto nt_byte = static_cast<std::uint8_t>(nt >> shift);
+        auto feed    = static_cast<std::uint8_t>((nuid ^ nt) >> shift);
+        auto ks_byte = cipher.byte(feed, false);
+
+        ret.keystream |= static_cast<std::uint32_t>(ks_byte) << shift;
+        *ret.parity   |= (odd_parity8(nt_byte) ^ cipher.peek()) << i;
+    }
+    return ret;
+}
+
+std::size_t peak_rss() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+#elif defined(__APPLE__)
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss * 1024uz;
+#endif
+}
+
+// Best of repeat runs, in nanoseconds.
+template <typename Setup, typename Fn>
+double measure(std::size_t repeat, Setup&& setup, Fn&& fn) {
+    using namespace std::chrono;
+
+    auto best = duration<double, std::nano>::max();
+    for (auto i = 0uz; i < repeat; i++) {
+        setup();
+        auto start = steady_clock::now();
+        fn();
+        best = std::min<duration<double, std::nano>>(
+            best,
+            steady_clock::now() - start
+        );
+    }
+    return best.count();
+}
+
+double per_item(double ns, std::size_t items) {
+    return items ? ns / items : 0;
+}
+
+// The join as it was before the radix partitioning, kept as the reference:
+// comparison sorts by the 16-bit rollback key, a merge of the matching
+// clusters, then a global sort of both sides for set_intersection.
+std::vector<std::uint64_t> sort_join(
+    std::span<const EncryptedNonce, 2> nt_encs,
+    std::uint32_t                      nuid
+) {
+    auto recover = [&](const EncryptedNonce& nt_enc) {
+        std::vector<Crypto1State> ret;
+        auto                      states = MifareCrypto1Cipher::recovery32(
+            nt_enc.keystream,
+            nt_enc.nonce ^ nuid
+        );
+        if (states) {
+            for (auto& state : *states) {
+                ret.emplace_back(state.odd(), state.even());
+            }
+        }
+        return ret;
+    };
+    auto states_a = recover(nt_encs[0]);
+    auto states_b = recover(nt_encs[1]);
+
+    auto key16 = [](const Crypto1State& state) {
+        return static_cast<std::uint64_t>(state.even & 0xff0000) << 32
+             | (state.odd & 0xff0000);
+    };
+    std::ranges::sort(states_a, std::ranges::greater{}, key16);
+    std::ranges::sort(states_b, std::ranges::greater{}, key16);
+
+    std::vector<std::uint64_t> rolled_a, rolled_b;
+
+    auto rollback = [&](auto& states, auto& it, auto& out, std::uint32_t in) {
+        auto key = key16(*it);
+        for (; it != states.end() && key16(*it) == key; it++) {
+            auto state = *it;
+            state.rollback_word(in, false);
+            out.push_back(state.pack());
+        }
+    };
+
+    auto it_a = states_a.begin();
+    auto it_b = states_b.begin();
+    while (it_a != states_a.end() && it_b != states_b.end()) {
+        if (key16(*it_a) > key16(*it_b)) {
+            it_a++;
+        } else if (key16(*it_a) < key16(*it_b)) {
+            it_b++;
+        } else {
+            rollback(states_a, it_a, rolled_a, nt_encs[0].nonce ^ nuid);
+            rollback(states_b, it_b, rolled_b, nt_encs[1].nonce ^ nuid);
+        }
+    }
+
+    std::ranges::sort(rolled_a);
+    std::ranges::sort(rolled_b);
+
+    std::vector<std::uint64_t> ret;
+    std::ranges::set_intersection(rolled_a, rolled_b, std::back_inserter(ret));
+    return ret;
+}
+
+std::size_t paired_states(std::span<const ClusterPair> clusters) {
+    auto ret = 0uz;
+    for (auto& cluster : clusters) {
+        ret += cluster.states_a.size() + cluster.states_b.size();
+    }
+    return ret;
+}
+
+// Returns false if the real key is not among the candidates, or the two joins
+// disagree.
+bool run_fixture(
+    const Fixture&               fixture,
+    std::span<const std::size_t> thread_counts,
+    std::size_t                  repeat
+) {
+    std::array nt_encs = {
+        encrypt_nonce(
+            fixture.key,
+            fixture.nuid,
+            prng_successor(fixture.nt_1, fixture.distances[0])
+        ),
+        encrypt_nonce(
+            fixture.key,
+            fixture.nuid,
+            prng_successor(fixture.nt_1, fixture.distances[1])
+        ),
+    };
+
+    std::println("[{}]", fixture.name);
+    for (auto i : std::views::iota(0uz, nt_encs.size())) {
+        std::println(
+            "  NtEnc_{} = {:08X} KeyStream_{} = {:08X}",
+            i,
+            nt_encs[i].nonce ^ nt_encs[i].keystream,
+            i,
+            nt_encs[i].keystream
+        );
+    }
+
+    PartitionedStates          states_a, states_b;
+    std::vector<ClusterPair>   clusters;
+    std::vector<std::uint64_t> candidates;
+
+    auto recover = [&] {
+        states_a = recovery_partition(nt_encs[0], fixture.nuid);
+        states_b = recovery_partition(nt_encs[1], fixture.nuid);
+        clusters = pair_clusters(states_a, states_b);
+    };
+    auto rollback = [&](std::size_t threads) {
+        rollback_paired_states(
+            clusters,
+            nt_encs[0],
+            nt_encs[1],
+            fixture.nuid,
+            threads
+        );
+    };
+
+    auto recovery_ns = measure(repeat, [] {}, recover);
+    auto recovered   = states_a.states.size() + states_b.states.size();
+    auto paired      = paired_states(clusters);
+    auto state_bytes = (states_a.states.size() + states_b.states.size())
+                         * sizeof(std::uint64_t)
+                     + (states_a.offsets.size() + states_b.offsets.size())
+                           * sizeof(std::uint32_t);
+
+    std::println(
+        "  {} states recovered, {} of them paired in {} clusters ({:.1f} MiB)",
+        recovered,
+        paired,
+        clusters.size(),
+        state_bytes / 1048576.0
+    );
+    std::println(
+        "  {:<22} {:>10.2f} ns/state",
+        "recovery_partition",
+        per_item(recovery_ns, recovered)
+    );
+
+    std::println(
+        "  {:>7} {:>20} {:>20} {:>16}",
+        "threads",
+        "rollback ns/state",
+        "intersect ns/state",
+        "speedup"
+    );
+    double baseline = 0;
+    for (auto threads : thread_counts) {
+        auto rollback_ns =
+            measure(repeat, recover, [&] { rollback(threads); });
+        auto intersect_ns = measure(
+            repeat,
+            [&] {
+                recover();
+                rollback(threads);
+            },
+            [&] { candidates = find_intersection(clusters, threads); }
+        );
+        auto total = rollback_ns + intersect_ns;
+        if (!baseline) baseline = total;
+        std::println(
+            "  {:>7} {:>20.2f} {:>20.2f} {:>15.2f}x",
+            threads,
+            per_item(rollback_ns, paired),
+            per_item(intersect_ns, paired),
+            baseline / total
+        );
+    }
+
+    std::vector<std::uint64_t> keys(candidates.size());
+
+    auto to_keys = [&] {
+        std::ranges::transform(candidates, keys.begin(), [](auto state) {
+            return Crypto1State::unpack(state).lfsr();
+        });
+    };
+    auto lfsr_ns = measure(repeat, [] {}, to_keys);
+    std::println(
+        "  {:<22} {:>10.2f} ns/candidate",
+        "get_lfsr",
+        per_item(lfsr_ns, candidates.size())
+    );
+
+    // Before and after on one thread, recovery32 included on both sides.
+    // Without the parity bits, so that the new join sees every recovered
+    // state too and both give the same set.
+    auto no_parity = nt_encs;
+    for (auto& nt_enc : no_parity) {
+        nt_enc.parity.reset();
+    }
+    std::vector<std::uint64_t> before, after;
+
+    auto sort_join_ns = measure(
+        repeat,
+        [] {},
+        [&] { before = sort_join(no_parity, fixture.nuid); }
+    );
+    auto radix_join_ns = measure(
+        repeat,
+        [] {},
+        [&] { after = recover_candidates(no_parity, fixture.nuid, 1); }
+    );
+    std::ranges::sort(after);
+    std::println(
+        "  {:<22} {:>10.2f} ms",
+        "sort join (before)",
+        sort_join_ns / 1e6
+    );
+    std::println(
+        "  {:<22} {:>10.2f} ms {:>10.2f}x{}",
+        "radix join (after)",
+        radix_join_ns / 1e6,
+        sort_join_ns / radix_join_ns,
+        before == after ? "" : ", candidates DIFFER"
+    );
+
+    auto found = std::ranges::contains(keys, fixture.key);
+    // Never goes down, so after the first fixture it is the highest of all
+    // that ran so far.
+    std::println(
+        "  {} candidate keys, the real key is {}. Peak RSS so far {:.1f} MiB.",
+        keys.size(),
+        found ? "among them" : "MISSING",
+        peak_rss() / 1048576.0
+    );
+    return found && before == after;
+}
+
+// Online key testing against a simulated tag, every frame costs latency and
+// every frame without an answer costs timeout on top of that.
+void run_key_test(
+    std::chrono::microseconds latency,
+    std::chrono::microseconds timeout,
+    std::size_t               count
+) {
+    using namespace std::chrono;
+
+    constexpr std::uint8_t  block = 4;
+    constexpr std::uint64_t key   = 0xA0A1A2A3A4A5;
+
+    SimulatedTag tag({
+        .keys    = {{block_to_sector(block), key, key}},
+        .latency = latency,
+        .timeout = timeout,
+    });
+
+    MifareClassicInitiator initiator(tag);
+    Crypto1State           cipher{};
+
+    auto card = initiator.select_card();
+    if (!card) {
+        throw std::runtime_error("The simulated tag did not answer.");
+    }
+
+    // Wrong keys first, the real one last, like the candidate sweep.
+    auto keys_per_second = [&](auto&& test_key) {
+        auto start = steady_clock::now();
+        for (auto i : std::views::iota(0uz, count)) {
+            if (test_key(i)) {
+                throw std::runtime_error("A wrong key was accepted.");
+            }
+        }
+        if (!test_key(key)) {
+            throw std::runtime_error("The real key was rejected.");
+        }
+        duration<double> elapsed = steady_clock::now() - start;
+        return (count + 1) / elapsed.count();
+    };
+
+    auto before = keys_per_second([&](std::uint64_t candidate) {
+        return initiator
+            .test_key(cipher, MifareKey::A, *card, block, candidate);
+    });
+
+    MifareKeyTester tester(initiator, *card);
+
+    auto after = keys_per_second([&](std::uint64_t candidate) {
+        return tester.test_key(cipher, MifareKey::A, block, candidate);
+    });
+
+    std::println(
+        "[key-test] latency {} us, timeout {} us",
+        latency.count(),
+        timeout.count()
+    );
+    std::println("  {:<22} {:>10.2f} keys/s", "select_card + test_key", before);
+    std::println("  {:<22} {:>10.2f} keys/s", "MifareKeyTester", after);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    argparse::ArgumentParser program("bench", "0.1.0");
+
+    program.add_argument("-f", "--fixture")
+        .append()
+        .help("Only run the given fixtures.");
+    program.add_argument("-j", "--threads")
+        .default_value(0uz)
+        .scan<'u', std::size_t>()
+        .help("Highest thread count to scale up to, 0 means all cores.");
+    program.add_argument("-r", "--repeat")
+        .default_value(3uz)
+        .scan<'u', std::size_t>()
+        .help("Runs per measurement, the best one is reported.");
+    program.add_argument("--frame-latency")
+        .default_value(1000uz)
+        .scan<'u', std::size_t>()
+        .help("Latency of every frame in the key-test, in us.");
+    program.add_argument("--frame-timeout")
+        .default_value(10000uz)
+        .scan<'u', std::size_t>()
+        .help("Extra time of a frame without answer in the key-test, in us.");
+
+    program.add_description(
+        "Benchmarks the offline phase of the staticnested attack."
+    );
+
+    try {
+        program.parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::println("{}", e.what());
+        return 1;
+    }
+
+    using std::chrono::microseconds;
+
+    auto selected = program.get<std::vector<std::string>>("-f");
+    auto threads  = util::resolve_threads(program.get<std::size_t>("-j"));
+    auto repeat   = std::max(1uz, program.get<std::size_t>("-r"));
+    auto latency  = microseconds(program.get<std::size_t>("--frame-latency"));
+    auto timeout  = microseconds(program.get<std::size_t>("--frame-timeout"));
+
+    std::vector<std::size_t> thread_counts;
+    for (auto i = 1uz; i < threads; i *= 2) {
+        thread_counts.push_back(i);
+    }
+    thread_counts.push_back(threads);
+
+    auto failed = 0uz;
+    for (auto& fixture : fixtures) {
+        if (!selected.empty()
+            && !std::ranges::contains(selected, fixture.name)) {
+            continue;
+        }
+        if (!run_fixture(fixture, thread_counts, repeat)) failed++;
+    }
+
+    if (selected.empty() || std::ranges::contains(selected, "key-test")) {
+        run_key_test(latency, timeout, 50);
+    }
+
+    // A solver that loses the key must not pass for a slow one.
+    if (failed) {
+        std::println(
+            "{} fixtures lost the real key or the joins disagreed.",
+            failed
+        );
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <optional>
+#include <vector>
+
+namespace nfcpp::util {
+
+// Bounded lock-free MPMC queue (Vyukov), producers block while it is full
+// and consumers block while it is empty, both without spinning.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity)
+    : m_cells(std::bit_ceil(capacity)),
+      m_mask(m_cells.size() - 1) {
+        for (auto i = 0uz; i < m_cells.size(); i++) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool try_push(const T& value) {
+        auto pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            auto& cell = m_cells[pos & m_mask];
+            auto  seq  = cell.sequence.load(std::memory_order_acquire);
+            auto  diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(
+                        pos,
+                        pos + 1,
+                        std::memory_order_relaxed
+                    )) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    notify(m_pushed, m_pop_waiters);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<T> try_pop() {
+        auto pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            auto& cell = m_cells[pos & m_mask];
+            auto  seq  = cell.sequence.load(std::memory_order_acquire);
+            auto  diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+            if (diff == 0) {
+                if (m_dequeue_pos.compare_exchange_weak(
+                        pos,
+                        pos + 1,
+                        std::memory_order_relaxed
+                    )) {
+                    T value = std::move(cell.value);
+                    cell.sequence.store(
+                        pos + m_mask + 1,
+                        std::memory_order_release
+                    );
+                    notify(m_popped, m_push_waiters);
+                    return value;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Returns false if the queue was closed before the value got in.
+    bool push(const T& value) {
+        while (!closed()) {
+            auto popped = m_popped.load();
+            if (try_push(value)) return true;
+            wait(m_popped, popped, m_push_waiters);
+        }
+        return false;
+    }
+
+    // Returns std::nullopt once the queue is closed and drained.
+    std::optional<T> pop() {
+        while (true) {
+            auto pushed = m_pushed.load();
+            if (auto value = try_pop()) return value;
+            if (closed()) return try_pop();
+            wait(m_pushed, pushed, m_pop_waiters);
+        }
+    }
+
+    // Wakes up every blocked producer and consumer.
+    void close() {
+        m_closed.store(true);
+        m_pushed.fetch_add(1);
+        m_popped.fetch_add(1);
+        m_pushed.notify_all();
+        m_popped.notify_all();
+    }
+
+    bool closed() const { return m_closed.load(); }
+
+private:
+    // The event counters are only notified when someone is waiting on them,
+    // the common uncontended case stays free of syscalls.
+    static void
+    notify(std::atomic<std::size_t>& counter, std::atomic<int>& waiters) {
+        counter.fetch_add(1);
+        if (waiters.load() > 0) counter.notify_all();
+    }
+
+    static void wait(
+        std::atomic<std::size_t>& counter,
+        std::size_t               old,
+        std::atomic<int>&         waiters
+    ) {
+        waiters.fetch_add(1);
+        counter.wait(old);
+        waiters.fetch_sub(1);
+    }
+
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T                        value;
+    };
+
+    std::vector<Cell> m_cells;
+    std::size_t       m_mask;
+
+    alignas(64) std::atomic<std::size_t> m_enqueue_pos{};
+    alignas(64) std::atomic<std::size_t> m_dequeue_pos{};
+    alignas(64) std::atomic<std::size_t> m_pushed{};
+    alignas(64) std::atomic<std::size_t> m_popped{};
+    std::atomic<int>  m_pop_waiters{};
+    std::atomic<int>  m_push_waiters{};
+    std::atomic<bool> m_closed{};
+};
+
+} // namespace nfcpp::util
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include "common/candidate_cache.h"
+
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace nfcpp::static_nested {
+
+CandidateCache::CandidateCache(std::filesystem::path directory)
+: m_directory(std::move(directory)) {
+    std::filesystem::create_directories(m_directory);
+}
+
+std::optional<std::vector<std::uint64_t>> CandidateCache::find(
+    std::span<const EncryptedNonce, 2> nt_encs,
+    std::uint32_t                      nuid
+) const {
+    std::ifstream ifs(path_of(nt_encs, nuid), std::ios::binary);
+    if (!ifs) return std::nullopt;
+
+    std::string data{
+        std::istreambuf_iterator<char>(ifs),
+        std::istreambuf_iterator<char>()
+    };
+    if (!data.starts_with(cache_magic)
+        || data.size() < cache_magic.size() + 8) {
+        return std::nullopt;
+    }
+
+    auto          pos = cache_magic.size();
+    std::uint64_t count{};
+    for (auto i = 0uz; i < 8; i++) {
+        auto byte  = static_cast<std::uint8_t>(data[pos++]);
+        count     |= static_cast<std::uint64_t>(byte) << (8 * i);
+    }
+    // Every state takes at least one byte.
+    if (count > data.size() - pos) return std::nullopt;
+
+    std::vector<std::uint64_t> ret;
+    ret.reserve(count);
+    std::uint64_t state{};
+    while (ret.size() < count) {
+        std::uint64_t delta{};
+        for (auto shift = 0; shift < 49; shift += 7) {
+            if (pos == data.size()) return std::nullopt;
+            auto byte  = static_cast<std::uint8_t>(data[pos++]);
+            delta     |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        state += delta;
+        if (state >> 48) return std::nullopt;
+        ret.push_back(state);
+    }
+    if (pos != data.size()) return std::nullopt;
+    return ret;
+}
+
+void CandidateCache::add(
+    std::span<const EncryptedNonce, 2> nt_encs,
+    std::uint32_t                      nuid,
+    std::span<const std::uint64_t>     states
+) {
+    std::string data(cache_magic);
+    for (auto i = 0uz; i < 8; i++) {
+        data += static_cast<char>(states.size() >> (8 * i));
+    }
+    std::uint64_t previous{};
+    for (auto state : states) {
+        auto delta = state - std::exchange(previous, state);
+        do {
+            auto byte   = static_cast<std::uint8_t>(delta & 0x7F);
+            delta     >>= 7;
+            data       += static_cast<char>(delta ? byte | 0x80 : byte);
+        } while (delta);
+    }
+
+    std::scoped_lock lock(m_mutex);
+
+    // Written aside first, an interrupted add leaves no broken set behind.
+    auto path = path_of(nt_encs, nuid);
+    auto temp = path;
+    temp += ".tmp";
+    {
+        std::ofstream ofs(temp, std::ios::binary);
+        if (!ofs.write(data.data(), data.size())) {
+            throw std::runtime_error("Can't write file.");
+        }
+    }
+    std::filesystem::rename(temp, path);
+}
+
+std::filesystem::path CandidateCache::path_of(
+    std::span<const EncryptedNonce, 2> nt_encs,
+    std::uint32_t                      nuid
+) const {
+    return m_directory
+         / std::format(
+               "{:08X}{:08X}{:08X}{:08X}{:08X}",
+               nt_encs[0].nonce,
+               nt_encs[0].keystream,
+               nt_encs[1].nonce,
+               nt_encs[1].keystream,
+               nuid
+         );
+}
+
+} // namespace nfcpp::static_nested
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <mutex>
+#include <optional>
+
+#include "types.h"
+
+namespace nfcpp::static_nested {
+
+// The candidate states recovered from the first two nonces of a capture, by
+// nonces, keystreams and NUID. A static nonce tag captures the same nonces on
+// every attack of a target, which then skips the offline phase.
+//
+// Every set is a file of its own in the directory, named after the nonces and
+// replaced as a whole. It is cache_magic, the number of states (8 bytes little
+// endian) and the sorted packed states (see Crypto1State::pack) as LEB128
+// deltas from the previous one. Safe to use from several threads.
+class CandidateCache {
+public:
+    static constexpr std::string_view cache_magic = "MFCAND01";
+
+    // Creates the directory if it does not exist yet.
+    explicit CandidateCache(std::filesystem::path directory);
+
+    // Sorted, std::nullopt if the set is not known (or the file is broken).
+    std::optional<std::vector<std::uint64_t>> find(
+        std::span<const EncryptedNonce, 2> nt_encs,
+        std::uint32_t                      nuid
+    ) const;
+
+    // The states must be sorted.
+    void add(
+        std::span<const EncryptedNonce, 2> nt_encs,
+        std::uint32_t                      nuid,
+        std::span<const std::uint64_t>     states
+    );
+
+private:
+    std::filesystem::path
+    path_of(std::span<const EncryptedNonce, 2> nt_encs, std::uint32_t nuid)
+        const;
+
+    std::filesystem::path m_directory;
+    std::mutex            m_mutex;
+};
+
+} // namespace nfcpp::static_nested
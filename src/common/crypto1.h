@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <utility>
+
+namespace nfcpp::mifare {
+
+// A plain-value Crypto1 state, bit-compatible with crapto1's Crypto1State.
+// Unlike MifareCrypto1Cipher it packs into 48 bits, which is what the offline
+// phase stores millions of.
+struct Crypto1State {
+    std::uint32_t odd;
+    std::uint32_t even;
+
+    static constexpr std::uint32_t lf_poly_odd  = 0x29CE5C;
+    static constexpr std::uint32_t lf_poly_even = 0x870804;
+
+    static constexpr bool filter(std::uint32_t x) {
+        std::uint32_t f = 0;
+        f |= (0xf22c0 >> (x & 0xf)) & 16;
+        f |= (0x6c9c0 >> (x >> 4 & 0xf)) & 8;
+        f |= (0x3c8b0 >> (x >> 8 & 0xf)) & 4;
+        f |= (0x1e458 >> (x >> 12 & 0xf)) & 2;
+        f |= (0x0d938 >> (x >> 16 & 0xf)) & 1;
+        return (0xEC57E80A >> f) & 1;
+    }
+
+    static constexpr Crypto1State from_key(std::uint64_t key) {
+        Crypto1State ret{};
+        for (auto i = 47; i > 0; i -= 2) {
+            ret.odd  = ret.odd << 1 | ((key >> ((i - 1) ^ 7)) & 1);
+            ret.even = ret.even << 1 | ((key >> (i ^ 7)) & 1);
+        }
+        return ret;
+    }
+
+    // Even half in bits 24..47, odd half in bits 0..23.
+    static constexpr Crypto1State unpack(std::uint64_t packed) {
+        return {
+            static_cast<std::uint32_t>(packed & 0xffffff),
+            static_cast<std::uint32_t>(packed >> 24 & 0xffffff)
+        };
+    }
+
+    constexpr std::uint64_t pack() const {
+        return static_cast<std::uint64_t>(even & 0xffffff) << 24
+             | (odd & 0xffffff);
+    }
+
+    constexpr std::uint64_t lfsr() const {
+        std::uint64_t ret = 0;
+        for (auto i = 23; i >= 0; i--) {
+            ret = ret << 1 | ((odd >> (i ^ 3)) & 1);
+            ret = ret << 1 | ((even >> (i ^ 3)) & 1);
+        }
+        return ret;
+    }
+
+    // The next keystream bit, without clocking the LFSR.
+    constexpr bool peek() const { return filter(odd); }
+
+    constexpr bool bit(bool in, bool encrypted) {
+        auto ret = filter(odd);
+
+        std::uint32_t feedin = ret && encrypted;
+        feedin ^= in;
+        feedin ^= lf_poly_odd & odd;
+        feedin ^= lf_poly_even & even;
+        even = even << 1 | (std::popcount(feedin) & 1);
+
+        std::swap(odd, even);
+        return ret;
+    }
+
+    constexpr std::uint8_t byte(std::uint8_t in, bool encrypted) {
+        std::uint8_t ret = 0;
+        for (auto i = 0; i < 8; i++) {
+            ret |= bit((in >> i) & 1, encrypted) << i;
+        }
+        return ret;
+    }
+
+    // Bytes are clocked in big-endian order, bits LSB first.
+    constexpr std::uint32_t word(std::uint32_t in, bool encrypted) {
+        std::uint32_t ret = 0;
+        for (auto i = 0; i < 32; i++) {
+            ret |= static_cast<std::uint32_t>(
+                       bit((in >> (i ^ 24)) & 1, encrypted)
+                   )
+                << (i ^ 24);
+        }
+        return ret;
+    }
+
+    constexpr bool rollback_bit(bool in, bool fb) {
+        odd &= 0xffffff;
+        std::swap(odd, even);
+
+        std::uint32_t out = even & 1;
+        even >>= 1;
+        out ^= lf_poly_even & even;
+        out ^= lf_poly_odd & odd;
+        out ^= in;
+
+        auto ret = filter(odd);
+        out ^= ret && fb;
+
+        even |= (std::popcount(out) & 1) << 23;
+        return ret;
+    }
+
+    constexpr std::uint32_t rollback_word(std::uint32_t in, bool fb) {
+        std::uint32_t ret = 0;
+        for (auto i = 31; i >= 0; i--) {
+            ret |= static_cast<std::uint32_t>(
+                       rollback_bit((in >> (i ^ 24)) & 1, fb)
+                   )
+                << (i ^ 24);
+        }
+        return ret;
+    }
+};
+
+} // namespace nfcpp::mifare
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include "common/event_log.h"
+
+#include <chrono>
+#include <cmath>
+
+namespace nfcpp::util {
+
+EventValue::EventValue(double value)
+: m_json(std::isfinite(value) ? std::format("{}", value) : "null") {}
+
+EventValue::EventValue(std::string_view value) {
+    m_json += '"';
+    for (auto ch : value) {
+        switch (ch) {
+        case '"':
+            m_json += "\\\"";
+            break;
+        case '\\':
+            m_json += "\\\\";
+            break;
+        case '\n':
+            m_json += "\\n";
+            break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20) {
+                m_json += std::format("\\u{:04x}", ch);
+            } else {
+                m_json += ch;
+            }
+        }
+    }
+    m_json += '"';
+}
+
+EventLog::EventLog(const std::filesystem::path& path) : m_ofs(path) {
+    if (!m_ofs) {
+        throw std::runtime_error("Can't open file.");
+    }
+}
+
+void EventLog::emit(
+    std::string_view                  event,
+    std::initializer_list<EventField> fields
+) {
+    using namespace std::chrono;
+
+    auto time = duration<double>(system_clock::now().time_since_epoch());
+
+    auto line = std::format(
+        "{{\"time\":{:.3f},\"event\":{}",
+        time.count(),
+        EventValue(event).json()
+    );
+    for (auto& [name, value] : fields) {
+        line += std::format(",\"{}\":{}", name, value.json());
+    }
+    line += "}\n";
+
+    std::scoped_lock lock(m_mutex);
+    if (m_sink) {
+        m_sink(line);
+    } else {
+        m_ofs << line << std::flush;
+    }
+}
+
+} // namespace nfcpp::util
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <concepts>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+
+namespace nfcpp::util {
+
+// A value already encoded as JSON.
+class EventValue {
+public:
+    EventValue(bool value) : m_json(value ? "true" : "false") {}
+
+    template <std::integral T>
+        requires(!std::same_as<T, bool>)
+    EventValue(T value) : m_json(std::format("{}", value)) {}
+
+    EventValue(double value);
+
+    EventValue(std::string_view value);
+
+    EventValue(const char* value) : EventValue(std::string_view(value)) {}
+
+    EventValue(const std::string& value)
+    : EventValue(std::string_view(value)) {}
+
+    const std::string& json() const { return m_json; }
+
+private:
+    std::string m_json;
+};
+
+struct EventField {
+    std::string_view name;
+    EventValue       value;
+};
+
+// Machine readable progress, one JSON object per line and flushed right away:
+// {"time":1767225600.125,"event":"candidates","block":4,"count":1024}
+// Safe to use from several threads.
+class EventLog {
+public:
+    explicit EventLog(const std::filesystem::path& path);
+
+    // Every line goes to sink instead, e.g. a socket.
+    explicit EventLog(std::function<void(std::string_view)> sink)
+    : m_sink(std::move(sink)) {}
+
+    void emit(std::string_view event, std::initializer_list<EventField> fields);
+
+private:
+    std::mutex                            m_mutex;
+    std::ofstream                         m_ofs;
+    std::function<void(std::string_view)> m_sink;
+};
+
+// Does nothing without a log, so call sites stay one-liners.
+inline void emit_event(
+    EventLog*                         log,
+    std::string_view                  event,
+    std::initializer_list<EventField> fields = {}
+) {
+    if (log) log->emit(event, fields);
+}
+
+} // namespace nfcpp::util
@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <format>
+#include <print>
+#include <string>
+
+#include "common/frame_stats.h"
+
+namespace nfcpp::mifare {
+
+namespace {
+
+constexpr std::array op_names =
+    {"select", "hlta", "auth", "read", "nonce", "rats"};
+
+constexpr std::array outcome_names = {"ok", "timeout", "nack", "error"};
+
+std::string format_latency(std::chrono::microseconds latency) {
+    if (latency.count() < 1000) {
+        return std::format("{} us", latency.count());
+    }
+    return std::format("{:.2f} ms", latency.count() / 1e3);
+}
+
+} // namespace
+
+std::size_t LatencyHistogram::bucket_of(std::uint64_t us) {
+    if (us < sub_buckets) return us;
+    auto shift = std::bit_width(us) - sub_bucket_bits;
+    return sub_buckets + (shift - 1) * sub_buckets / 2
+         + ((us >> shift) - sub_buckets / 2);
+}
+
+std::uint64_t LatencyHistogram::lowest_of(std::size_t bucket) {
+    if (bucket < sub_buckets) return bucket;
+    auto shift = (bucket - sub_buckets) / (sub_buckets / 2) + 1;
+    auto top   = (bucket - sub_buckets) % (sub_buckets / 2) + sub_buckets / 2;
+    return top << shift;
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency) {
+    auto us = std::clamp<std::int64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(latency).count(),
+        0,
+        (1ll << value_bits) - 1
+    );
+    m_buckets[bucket_of(us)].fetch_add(1, relaxed);
+    m_count.fetch_add(1, relaxed);
+    m_total.fetch_add(us, relaxed);
+
+    auto max = m_max.load(relaxed);
+    while (static_cast<std::uint64_t>(us) > max
+           && !m_max.compare_exchange_weak(max, us, relaxed)) {}
+}
+
+std::chrono::microseconds LatencyHistogram::percentile(double quantile) const {
+    auto          rank = std::max(1.0, std::ceil(quantile * count()));
+    std::uint64_t seen = 0;
+    for (auto i = 0uz; i < bucket_count; i++) {
+        seen += m_buckets[i].load(relaxed);
+        if (seen >= rank) {
+            return std::chrono::microseconds(lowest_of(i));
+        }
+    }
+    return max();
+}
+
+void FrameStats::print() const {
+    std::println("Frame statistics:");
+    std::println(
+        "  {:<8}{:<9}{:>9}{:>12}{:>11}{:>11}{:>11}{:>11}",
+        "frame",
+        "outcome",
+        "count",
+        "total",
+        "p50",
+        "p90",
+        "p99",
+        "max"
+    );
+    for (auto op = 0uz; op < op_names.size(); op++) {
+        for (auto outcome = 0uz; outcome < outcome_names.size(); outcome++) {
+            auto& histogram = m_histograms[op][outcome];
+            if (!histogram.count()) continue;
+            std::println(
+                "  {:<8}{:<9}{:>9}{:>12}{:>11}{:>11}{:>11}{:>11}",
+                op_names[op],
+                outcome_names[outcome],
+                histogram.count(),
+                std::format("{:.3f} s", histogram.total().count() / 1e6),
+                format_latency(histogram.percentile(0.5)),
+                format_latency(histogram.percentile(0.9)),
+                format_latency(histogram.percentile(0.99)),
+                format_latency(histogram.max())
+            );
+        }
+    }
+}
+
+} // namespace nfcpp::mifare
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace nfcpp::mifare {
+
+// What MifareClassicInitiator sent the frame for.
+enum class FrameOp { select, hlta, auth, read, nonce, rats };
+
+enum class FrameOutcome {
+    ok,
+    timeout, // NfcError::RFTRANS, the tag did not answer.
+    nack,    // A 4-bit NACK or NfcError::INVARG.
+    error,
+};
+
+// HDR-style latency histogram in microseconds: exact below 32 us, then 16
+// sub-buckets per power of two, so any value is off by less than 1/16. Values
+// are clamped to 2^32 us. Lock-free, record() may race with reads.
+class LatencyHistogram {
+public:
+    void record(std::chrono::nanoseconds latency);
+
+    std::uint64_t count() const { return m_count.load(relaxed); }
+
+    std::chrono::microseconds total() const {
+        return std::chrono::microseconds(m_total.load(relaxed));
+    }
+
+    std::chrono::microseconds max() const {
+        return std::chrono::microseconds(m_max.load(relaxed));
+    }
+
+    // The lowest value of the bucket holding the quantile, in [0, 1].
+    std::chrono::microseconds percentile(double quantile) const;
+
+private:
+    static constexpr auto relaxed         = std::memory_order_relaxed;
+    static constexpr auto value_bits      = 32;
+    static constexpr auto sub_bucket_bits = 5;
+    static constexpr auto sub_buckets     = 1uz << sub_bucket_bits;
+    static constexpr auto bucket_count =
+        sub_buckets + (value_bits - sub_bucket_bits) * sub_buckets / 2;
+
+    static std::size_t   bucket_of(std::uint64_t us);
+    static std::uint64_t lowest_of(std::size_t bucket);
+
+    std::array<std::atomic<std::uint64_t>, bucket_count> m_buckets{};
+    std::atomic<std::uint64_t>                           m_count{};
+    std::atomic<std::uint64_t>                           m_total{};
+    std::atomic<std::uint64_t>                           m_max{};
+};
+
+// One histogram per operation and outcome.
+class FrameStats {
+public:
+    void record(
+        FrameOp                  op,
+        FrameOutcome             outcome,
+        std::chrono::nanoseconds latency
+    ) {
+        m_histograms[static_cast<std::size_t>(op)]
+                    [static_cast<std::size_t>(outcome)]
+                        .record(latency);
+    }
+
+    // Can be called at any time, also while frames are being recorded.
+    void print() const;
+
+private:
+    std::array<std::array<LatencyHistogram, 4>, 6> m_histograms;
+};
+
+} // namespace nfcpp::mifare
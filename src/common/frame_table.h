@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <stdexcept>
+
+#include "common/iso14443a_frame.h"
+
+#include "types.h"
+
+// Frames are encoded once (CRC_A and parity included) and copied out of these
+// tables afterwards, encrypted frames are encrypted in place on the copy.
+namespace nfcpp::mifare::frames {
+
+namespace detail {
+
+constexpr auto make_block_frames(std::uint8_t cmd) {
+    std::array<RawFrame, 256> ret;
+    for (auto block = 0uz; block < ret.size(); block++) {
+        ret[block] = make_frame({cmd, static_cast<std::uint8_t>(block)}, true);
+    }
+    return ret;
+}
+
+} // namespace detail
+
+inline constexpr RawFrame reqa = short_frame(0x26);
+inline constexpr RawFrame wupa = short_frame(0x52);
+inline constexpr RawFrame hlta = make_frame({0x50, 0x00}, true);
+inline constexpr RawFrame rats = make_frame({0xE0, 0x50}, true);
+
+inline constexpr auto auth_a = detail::make_block_frames(0x60);
+inline constexpr auto auth_b = detail::make_block_frames(0x61);
+inline constexpr auto read   = detail::make_block_frames(0x30);
+
+constexpr RawFrame auth(MifareKey key_type, std::uint8_t block) {
+    switch (key_type) {
+    case MifareKey::A:
+        return auth_a[block];
+    case MifareKey::B:
+        return auth_b[block];
+    }
+    // Vendor commands, e.g. the fm11rf08s backdoor.
+    return make_frame({static_cast<std::uint8_t>(key_type), block}, true);
+}
+
+// The SELECT of every cascade level of a known UID, built once per card.
+struct SelectFrames {
+    std::array<RawFrame, 3> frames{};
+    std::size_t             levels{};
+
+    constexpr std::span<const RawFrame> view() const {
+        return std::span(frames).first(levels);
+    }
+};
+
+constexpr SelectFrames make_select_frames(std::span<const std::uint8_t> uid) {
+    SelectFrames ret;
+    std::uint8_t cascade_level = 0x93;
+    for (auto offset = 0uz; offset < uid.size(); cascade_level += 2) {
+        if (ret.levels == ret.frames.size()) {
+            throw std::invalid_argument("Too many cascading levels.");
+        }
+        std::array<std::uint8_t, 4> uid_buf;
+        if (uid.size() - offset > 4) {
+            uid_buf = {0x88, uid[offset], uid[offset + 1], uid[offset + 2]};
+            offset += 3;
+        } else {
+            std::ranges::copy(uid.subspan(offset, 4), uid_buf.begin());
+            offset += 4;
+        }
+        std::uint8_t bcc = uid_buf[0] ^ uid_buf[1] ^ uid_buf[2] ^ uid_buf[3];
+        ret.frames[ret.levels++] = make_frame(
+            {cascade_level,
+             0x70,
+             uid_buf[0],
+             uid_buf[1],
+             uid_buf[2],
+             uid_buf[3],
+             bcc},
+            true
+        );
+    }
+    return ret;
+}
+
+} // namespace nfcpp::mifare::frames
@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include "common/frame_trace.h"
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace nfcpp::mifare {
+
+namespace {
+
+void put_varint(std::string& out, std::uint64_t value) {
+    do {
+        auto byte = static_cast<char>(value & 0x7f);
+        value >>= 7;
+        out += value ? static_cast<char>(byte | 0x80) : byte;
+    } while (value);
+}
+
+void put_frame(std::string& out, const RawFrame& frame) {
+    put_varint(out, frame.bits);
+    out.append(reinterpret_cast<const char*>(frame.bytes.data()), frame.size());
+    for (auto i = 0uz; i < frame.size(); i += 8) {
+        std::uint8_t packed{};
+        for (auto j = i; j < std::min(i + 8, frame.size()); j++) {
+            packed |= (frame.parity[j] & 1) << (j - i);
+        }
+        out += static_cast<char>(packed);
+    }
+}
+
+std::uint64_t zigzag(int value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ (value < 0 ? ~0ull : 0);
+}
+
+int unzigzag(std::uint64_t value) {
+    return static_cast<int>((value >> 1) ^ -(value & 1));
+}
+
+class TraceReader {
+public:
+    TraceReader(std::string_view data, const std::filesystem::path& path)
+    : m_data(data),
+      m_path(path) {}
+
+    bool empty() const { return m_pos == m_data.size(); }
+
+    std::size_t position() const { return m_pos; }
+
+    std::uint64_t varint() {
+        std::uint64_t ret{};
+        for (auto shift = 0; shift < 64; shift += 7) {
+            auto byte = static_cast<std::uint8_t>(take(1)[0]);
+            ret |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return ret;
+        }
+        invalid();
+    }
+
+    RawFrame frame() {
+        RawFrame ret;
+        ret.bits = varint();
+        if (ret.bits > RawFrame::max_size * 8) invalid();
+        auto bytes = take(ret.size());
+        std::ranges::copy(bytes, ret.bytes.begin());
+        auto parity = take((ret.size() + 7) / 8);
+        for (auto i = 0uz; i < ret.size(); i++) {
+            ret.parity[i] = parity[i / 8] >> (i % 8) & 1;
+        }
+        return ret;
+    }
+
+private:
+    std::string_view take(std::size_t size) {
+        if (m_data.size() - m_pos < size) invalid();
+        auto ret  = m_data.substr(m_pos, size);
+        m_pos    += size;
+        return ret;
+    }
+
+    [[noreturn]] void invalid() const {
+        throw std::runtime_error(
+            std::format("{} is not a valid trace.", m_path.string())
+        );
+    }
+
+    std::string_view             m_data;
+    const std::filesystem::path& m_path;
+    std::size_t                  m_pos{};
+};
+
+} // namespace
+
+TraceRecorder::TraceRecorder(
+    Transport&                   transport,
+    const std::filesystem::path& path
+)
+: m_transport(transport),
+  m_ofs(path, std::ios::binary),
+  m_last_sent(std::chrono::steady_clock::now()) {
+    if (!m_ofs) {
+        throw std::runtime_error("Can't open file.");
+    }
+    m_ofs << trace_magic << std::flush;
+}
+
+RawFrame TraceRecorder::transceive(const RawFrame& frame) {
+    using namespace std::chrono;
+
+    auto sent = steady_clock::now();
+    auto us   = [](auto duration) {
+        return static_cast<std::uint64_t>(
+            duration_cast<microseconds>(duration).count()
+        );
+    };
+
+    // Written out before returning, a crash still leaves a usable trace.
+    auto write = [&](int error, const RawFrame* answer) {
+        std::string record;
+        put_varint(record, us(sent - m_last_sent));
+        put_varint(record, us(steady_clock::now() - sent));
+        put_frame(record, frame);
+        put_varint(record, zigzag(error));
+        if (answer) put_frame(record, *answer);
+        m_ofs << record << std::flush;
+        m_last_sent = sent;
+    };
+
+    try {
+        auto ret = m_transport.transceive(frame);
+        write(0, &ret);
+        return ret;
+    } catch (const NfcException& e) {
+        write(static_cast<int>(e.error_code()), nullptr);
+        throw;
+    }
+}
+
+ReplayTransport::ReplayTransport(
+    const std::filesystem::path& path,
+    bool                         paced
+)
+: m_file(path),
+  m_paced(paced),
+  m_last_sent(std::chrono::steady_clock::now()) {
+    auto bytes = m_file.bytes();
+    auto data  = std::string_view(
+        reinterpret_cast<const char*>(bytes.data()),
+        bytes.size()
+    );
+    if (!data.starts_with(trace_magic)) {
+        throw std::runtime_error(
+            std::format("{} is not a valid trace.", path.string())
+        );
+    }
+    data.remove_prefix(trace_magic.size());
+
+    TraceReader reader(data, path);
+    while (!reader.empty()) {
+        auto& record   = m_records.emplace_back();
+        record.gap     = std::chrono::microseconds(reader.varint());
+        record.latency = std::chrono::microseconds(reader.varint());
+        auto begin     = reader.position();
+        reader.frame();
+        record.request = data.substr(begin, reader.position() - begin);
+        record.error   = unzigzag(reader.varint());
+        if (!record.error) record.answer = reader.frame();
+    }
+}
+
+RawFrame ReplayTransport::transceive(const RawFrame& frame) {
+    if (m_next == m_records.size()) {
+        throw std::runtime_error(std::format(
+            "The trace ends after {} frames, it was recorded from another "
+            "run.",
+            m_records.size()
+        ));
+    }
+    auto& record = m_records[m_next];
+
+    std::string request;
+    put_frame(request, frame);
+    if (request != record.request) {
+        throw std::runtime_error(std::format(
+            "Frame {} is not the one in the trace, it was recorded from "
+            "another run.",
+            m_next
+        ));
+    }
+    m_next++;
+
+    if (m_paced) {
+        std::this_thread::sleep_until(m_last_sent + record.gap);
+        m_last_sent = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(record.latency);
+    }
+    if (record.error) {
+        throw_nfc_error(static_cast<NfcError>(record.error));
+    }
+    return record.answer;
+}
+
+} // namespace nfcpp::mifare
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+#include "common/mapped_file.h"
+#include "common/transport.h"
+
+namespace nfcpp::mifare {
+
+// A trace is trace_magic followed by one record per frame sent:
+// - varint, us since the previous frame was sent.
+// - varint, us until the answer (or the error).
+// - The frame sent.
+// - varint, 0 if answered, otherwise the NfcError, zigzag encoded.
+// - The answer, if any.
+// A frame is its bits as a varint, its bytes, then its parity bits packed LSB
+// first.
+inline constexpr std::string_view trace_magic = "MFTRACE1";
+
+// Passes every frame on to transport and appends it to a trace file.
+class TraceRecorder : public Transport {
+public:
+    TraceRecorder(Transport& transport, const std::filesystem::path& path);
+
+    RawFrame transceive(const RawFrame& frame) override;
+
+private:
+    Transport&                            m_transport;
+    std::ofstream                         m_ofs;
+    std::chrono::steady_clock::time_point m_last_sent;
+};
+
+// Answers from a trace without hardware, frame by frame in the recorded order.
+// With paced, the recorded gaps and latencies are waited out as well,
+// otherwise it does not wait at all. Throws std::runtime_error on a frame that
+// is not the next one recorded, i.e. the trace is of another run.
+class ReplayTransport : public Transport {
+public:
+    explicit ReplayTransport(
+        const std::filesystem::path& path,
+        bool                         paced = false
+    );
+
+    RawFrame transceive(const RawFrame& frame) override;
+
+private:
+    struct Record {
+        std::chrono::microseconds gap;
+        std::chrono::microseconds latency;
+        std::string_view          request; // Encoded, right in the mapping.
+        RawFrame                  answer;
+        int                       error; // 0 if answered.
+    };
+
+    util::MappedFile                      m_file;
+    std::vector<Record>                   m_records;
+    std::size_t                           m_next{};
+    bool                                  m_paced;
+    std::chrono::steady_clock::time_point m_last_sent;
+};
+
+} // namespace nfcpp::mifare
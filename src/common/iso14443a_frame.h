@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+
+#include "common/crypto1.h"
+
+namespace nfcpp::mifare {
+
+// A frame as it goes over the air, one parity bit per byte. Short frames
+// (REQA/WUPA) and 4-bit ACK/NACKs are expressed through bits.
+struct RawFrame {
+    static constexpr std::size_t max_size = 32;
+
+    std::array<std::uint8_t, max_size> bytes{};
+    std::array<std::uint8_t, max_size> parity{};
+    std::size_t                        bits{};
+
+    constexpr std::size_t size() const { return (bits + 7) / 8; }
+
+    constexpr std::span<const std::uint8_t> data() const {
+        return std::span(bytes).first(size());
+    }
+};
+
+constexpr bool odd_parity8(std::uint8_t x) { return !(std::popcount(x) & 1); }
+
+constexpr std::uint16_t crc_a(std::span<const std::uint8_t> data) {
+    std::uint16_t crc = 0x6363;
+    for (auto byte : data) {
+        std::uint8_t ch = byte ^ (crc & 0xff);
+        ch ^= ch << 4;
+        crc = (crc >> 8) ^ (ch << 8) ^ (ch << 3) ^ (ch >> 4);
+    }
+    return crc;
+}
+
+constexpr RawFrame short_frame(std::uint8_t cmd) {
+    RawFrame ret;
+    ret.bytes[0] = cmd;
+    ret.bits     = 7;
+    return ret;
+}
+
+constexpr RawFrame
+make_frame(std::span<const std::uint8_t> data, bool with_crc) {
+    RawFrame ret;
+    auto     size = data.size();
+    std::ranges::copy(data, ret.bytes.begin());
+    if (with_crc) {
+        auto crc          = crc_a(data);
+        ret.bytes[size++] = crc & 0xff;
+        ret.bytes[size++] = crc >> 8;
+    }
+    for (auto i = 0uz; i < size; i++) {
+        ret.parity[i] = odd_parity8(ret.bytes[i]);
+    }
+    ret.bits = size * 8;
+    return ret;
+}
+
+constexpr RawFrame
+make_frame(std::initializer_list<std::uint8_t> data, bool with_crc) {
+    return make_frame(std::span(data.begin(), data.size()), with_crc);
+}
+
+constexpr bool check_crc(const RawFrame& frame) {
+    if (frame.bits < 24 || frame.bits % 8 != 0) return false;
+    auto size = frame.size();
+    auto crc  = crc_a(frame.data().first(size - 2));
+    return frame.bytes[size - 2] == (crc & 0xff)
+        && frame.bytes[size - 1] == (crc >> 8);
+}
+
+constexpr std::uint32_t get_u32(const RawFrame& frame) {
+    return static_cast<std::uint32_t>(frame.bytes[0]) << 24
+         | static_cast<std::uint32_t>(frame.bytes[1]) << 16
+         | static_cast<std::uint32_t>(frame.bytes[2]) << 8
+         | static_cast<std::uint32_t>(frame.bytes[3]);
+}
+
+constexpr void put_u32(std::span<std::uint8_t> out, std::uint32_t value) {
+    for (auto i = 0uz; i < 4; i++) {
+        out[i] = static_cast<std::uint8_t>(value >> (24 - 8 * i));
+    }
+}
+
+// Keys are stored big-endian in the sector trailer.
+constexpr std::uint64_t get_key(std::span<const std::uint8_t, 6> in) {
+    std::uint64_t ret{};
+    for (auto byte : in) {
+        ret = ret << 8 | byte;
+    }
+    return ret;
+}
+
+constexpr void put_key(std::span<std::uint8_t, 6> out, std::uint64_t key) {
+    for (auto i = 0uz; i < 6; i++) {
+        out[i] = static_cast<std::uint8_t>(key >> (40 - 8 * i));
+    }
+}
+
+// Encrypts in place, each parity bit with the keystream bit following its
+// byte. The first feed_bytes bytes are also clocked into the LFSR, which is
+// how the reader nonce is sent.
+constexpr void encrypt_frame(
+    RawFrame&     frame,
+    Crypto1State& cipher,
+    std::size_t   feed_bytes = 0
+) {
+    if (frame.bits < 8) {
+        std::uint8_t ks = 0;
+        for (auto i = 0uz; i < frame.bits; i++) {
+            ks |= cipher.bit(false, false) << i;
+        }
+        frame.bytes[0] ^= ks;
+        return;
+    }
+    for (auto i = 0uz; i < frame.size(); i++) {
+        auto plain       = frame.bytes[i];
+        frame.bytes[i]  ^= cipher.byte(i < feed_bytes ? plain : 0, false);
+        frame.parity[i]  = odd_parity8(plain) ^ cipher.peek();
+    }
+}
+
+// Decrypts a frame from the tag in place, parity bits included.
+constexpr void decrypt_frame(RawFrame& frame, Crypto1State& cipher) {
+    if (frame.bits < 8) {
+        std::uint8_t ks = 0;
+        for (auto i = 0uz; i < frame.bits; i++) {
+            ks |= cipher.bit(false, false) << i;
+        }
+        frame.bytes[0] ^= ks;
+        return;
+    }
+    for (auto i = 0uz; i < frame.size(); i++) {
+        frame.bytes[i]  ^= cipher.byte(0, false);
+        frame.parity[i] ^= cipher.peek();
+    }
+}
+
+} // namespace nfcpp::mifare
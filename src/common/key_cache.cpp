@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include "common/key_cache.h"
+
+#include "common/iso14443a_frame.h"
+
+#include <format>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace nfcpp::mifare {
+
+namespace {
+
+void put(
+    std::vector<std::uint8_t>& out,
+    std::uint64_t              value,
+    std::size_t                size
+) {
+    for (auto i = 0uz; i < size; i++) {
+        out.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+}
+
+std::uint64_t get(std::span<const std::uint8_t> data, std::size_t size) {
+    std::uint64_t ret{};
+    for (auto i = 0uz; i < size; i++) {
+        ret |= static_cast<std::uint64_t>(data[i]) << (8 * i);
+    }
+    return ret;
+}
+
+// The size of the record at the front of data, 0 if it is torn.
+std::size_t record_size(std::span<const std::uint8_t> data) {
+    if (data.empty()) return 0;
+    auto size = 1 + data[0] + 2 + 1 + 1 + 1 + 6 + 2;
+    return data.size() < size ? 0 : size;
+}
+
+bool record_intact(std::span<const std::uint8_t> record) {
+    auto size = record.size() - 2;
+    return crc_a(record.first(size)) == get(record.subspan(size), 2);
+}
+
+} // namespace
+
+KeyCache::KeyCache(std::filesystem::path path) : m_path(std::move(path)) {
+    std::ifstream ifs(m_path, std::ios::binary);
+    if (ifs) {
+        std::vector<std::uint8_t> data{
+            std::istreambuf_iterator<char>(ifs),
+            std::istreambuf_iterator<char>()
+        };
+        ifs.close();
+
+        auto text = std::string_view(
+            reinterpret_cast<const char*>(data.data()),
+            data.size()
+        );
+        // Torn within the magic is as good as empty.
+        auto header = cache_magic.starts_with(text) ? text.size()
+                                                    : cache_magic.size();
+        if (header == cache_magic.size() && !text.starts_with(cache_magic)) {
+            throw std::runtime_error(
+                std::format("{} is not a valid key cache.", m_path.string())
+            );
+        }
+
+        auto records = std::span(data).subspan(header);
+        while (auto size = record_size(records)) {
+            auto record = records.first(size);
+            records     = records.subspan(size);
+            // Corrupt in the middle, the records after it are still good.
+            if (!record_intact(record)) continue;
+
+            auto uid_size = record[0];
+            auto card     = ISO14443ACard{
+                .atqa = {record[1 + uid_size], record[2 + uid_size]},
+                .uid  = {record.begin() + 1, record.begin() + 1 + uid_size},
+                .nuid = {},
+                .sak  = record[3 + uid_size],
+            };
+            auto  sector = record[4 + uid_size];
+            auto  key    = get(record.subspan(6 + uid_size), 6);
+            auto& slot   = m_tags[tag_of(card)][sector];
+            slot.sector  = sector;
+            if (static_cast<MifareKey>(record[5 + uid_size]) == MifareKey::A) {
+                slot.key_a = key;
+            } else {
+                slot.key_b = key;
+            }
+        }
+
+        // Whatever is left was torn by a crash in the middle of a write.
+        if (header < cache_magic.size()) {
+            std::filesystem::resize_file(m_path, 0);
+        } else if (!records.empty()) {
+            std::filesystem::resize_file(m_path, data.size() - records.size());
+        }
+    }
+
+    auto fresh = !std::filesystem::exists(m_path)
+              || std::filesystem::is_empty(m_path);
+    m_ofs.open(m_path, std::ios::binary | std::ios::app);
+    if (!m_ofs) {
+        throw std::runtime_error("Can't open file.");
+    }
+    if (fresh) {
+        m_ofs.write(cache_magic.data(), cache_magic.size());
+        m_ofs.flush();
+    }
+}
+
+std::vector<SectorKey> KeyCache::find(const ISO14443ACard& card) const {
+    std::vector<SectorKey> ret;
+
+    auto it = m_tags.find(tag_of(card));
+    if (it == m_tags.end()) return ret;
+    for (auto& [sector, keys] : it->second) {
+        ret.push_back(keys);
+    }
+    return ret;
+}
+
+void KeyCache::add(
+    const ISO14443ACard& card,
+    std::uint8_t         sector,
+    MifareKey            key_type,
+    std::uint64_t        key
+) {
+    auto& slot  = m_tags[tag_of(card)][sector];
+    slot.sector = sector;
+    auto& known = key_type == MifareKey::A ? slot.key_a : slot.key_b;
+    if (known == key) return;
+    known = key;
+
+    std::vector<std::uint8_t> record;
+    put(record, card.uid.size(), 1);
+    record.append_range(card.uid);
+    record.append_range(card.atqa);
+    put(record, card.sak, 1);
+    put(record, sector, 1);
+    put(record, static_cast<std::uint8_t>(key_type), 1);
+    put(record, key, 6);
+    put(record, crc_a(record), 2);
+
+    m_ofs.write(reinterpret_cast<const char*>(record.data()), record.size());
+    if (!m_ofs.flush()) {
+        throw std::runtime_error("Can't write file.");
+    }
+}
+
+} // namespace nfcpp::mifare
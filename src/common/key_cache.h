@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <tuple>
+
+#include "types.h"
+
+namespace nfcpp::mifare {
+
+// The sector keys found on every tag, by UID, ATQA and SAK, so that a tag
+// seen before does not have to be attacked again. Its key chain is simply
+// every key in there.
+//
+// The file is cache_magic followed by one record per key, appended (and
+// flushed) as soon as the key is found:
+// - UID size, UID, ATQA, SAK, sector and key type, a byte each (but the UID
+//   and the ATQA).
+// - The key, 6 bytes little endian.
+// - CRC_A of all of the above, 2 bytes little endian.
+// A later record of the same key replaces the earlier one. A torn record at
+// the end, e.g. after a crash, is cut off when the file is opened, one that
+// fails its CRC is skipped.
+class KeyCache {
+public:
+    static constexpr std::string_view cache_magic = "MFKEYDB1";
+
+    // Starts empty if the file does not exist yet.
+    explicit KeyCache(std::filesystem::path path);
+
+    // Every sector of the tag with at least one key, by sector number.
+    std::vector<SectorKey> find(const ISO14443ACard& card) const;
+
+    void add(
+        const ISO14443ACard& card,
+        std::uint8_t         sector,
+        MifareKey            key_type,
+        std::uint64_t        key
+    );
+
+private:
+    using Tag = std::tuple<
+        std::vector<std::uint8_t>,
+        std::array<std::uint8_t, 2>,
+        std::uint8_t>;
+
+    static Tag tag_of(const ISO14443ACard& card) {
+        return {card.uid, card.atqa, card.sak};
+    }
+
+    std::filesystem::path                            m_path;
+    std::ofstream                                    m_ofs;
+    std::map<Tag, std::map<std::uint8_t, SectorKey>> m_tags;
+};
+
+} // namespace nfcpp::mifare
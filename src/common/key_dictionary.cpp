@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+#include "common/key_dictionary.h"
+
+namespace nfcpp::mifare {
+
+namespace {
+
+constexpr std::uint64_t get_u48(std::span<const std::uint8_t> record) {
+    std::uint64_t ret{};
+    for (auto byte : record.first(6)) {
+        ret = ret << 8 | byte;
+    }
+    return ret;
+}
+
+constexpr std::string_view trim(std::string_view str) {
+    constexpr std::string_view spaces = " \t\r";
+
+    auto begin = str.find_first_not_of(spaces);
+    if (begin == str.npos) return {};
+    return str.substr(begin, str.find_last_not_of(spaces) - begin + 1);
+}
+
+} // namespace
+
+std::uint64_t KeyDictionary::BinaryFile::operator[](std::size_t index) const {
+    return get_u48(records.subspan(index * 6));
+}
+
+bool KeyDictionary::BinaryFile::contains(std::uint64_t key) const {
+    // Binary search straight on the records.
+    std::size_t begin = 0, end = size();
+    while (begin < end) {
+        auto mid   = begin + (end - begin) / 2;
+        auto probe = (*this)[mid];
+        if (probe == key) return true;
+        if (probe < key) {
+            begin = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    return false;
+}
+
+void KeyDictionary::load(const std::filesystem::path& path) {
+    util::MappedFile file(path);
+
+    auto bytes = file.bytes();
+    auto text  = std::string_view(
+        reinterpret_cast<const char*>(bytes.data()),
+        bytes.size()
+    );
+
+    if (text.starts_with(binary_magic)) {
+        auto       records = bytes.subspan(binary_magic.size());
+        BinaryFile binary{std::move(file), records};
+        auto       valid = records.size() % 6 == 0;
+        for (auto i = 1uz; valid && i < binary.size(); i++) {
+            valid = binary[i - 1] < binary[i];
+        }
+        if (!valid) {
+            throw std::runtime_error(std::format(
+                "{} is not a valid binary dictionary.",
+                path.string()
+            ));
+        }
+        m_files.push_back(std::move(binary));
+        return;
+    }
+
+    // Parsed right out of the mapping, lines are never copied.
+    for (auto line_number = 1uz; !text.empty(); line_number++) {
+        auto eol  = text.find('\n');
+        auto line = text.substr(0, eol);
+        text      = text.substr(eol == text.npos ? text.size() : eol + 1);
+        line      = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+
+        std::uint64_t key{};
+        auto [ptr, ec] =
+            std::from_chars(line.data(), line.data() + line.size(), key, 16);
+        if (line.size() != 12 || ec != std::errc{}
+            || ptr != line.data() + line.size()) {
+            throw std::runtime_error(std::format(
+                "Malformed key at {}:{}.",
+                path.string(),
+                line_number
+            ));
+        }
+        m_keys.push_back(key);
+    }
+}
+
+void KeyDictionary::dedup(const std::set<std::uint64_t>& known) {
+    std::ranges::sort(m_keys);
+    auto [first, last] = std::ranges::unique(m_keys);
+    m_keys.erase(first, last);
+    std::erase_if(m_keys, [&](std::uint64_t key) {
+        return known.contains(key)
+            || std::ranges::any_of(m_files, [&](const BinaryFile& binary) {
+                   return binary.contains(key);
+               });
+    });
+}
+
+std::size_t KeyDictionary::size() const {
+    auto ret = m_keys.size();
+    for (auto& binary : m_files) {
+        ret += binary.size();
+    }
+    return ret;
+}
+
+std::uint64_t KeyDictionary::operator[](std::size_t index) const {
+    if (index < m_keys.size()) return m_keys[index];
+    index -= m_keys.size();
+    for (auto& binary : m_files) {
+        if (index < binary.size()) return binary[index];
+        index -= binary.size();
+    }
+    throw std::out_of_range("Key index out of range.");
+}
+
+std::size_t KeyDictionary::save(const std::filesystem::path& path) const {
+    std::vector<std::uint64_t> keys;
+    keys.reserve(size());
+    for (auto i = 0uz; i < size(); i++) {
+        keys.push_back((*this)[i]);
+    }
+    std::ranges::sort(keys);
+    auto [first, last] = std::ranges::unique(keys);
+    keys.erase(first, last);
+
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs) {
+        throw std::runtime_error("Can't open file.");
+    }
+    ofs.write(binary_magic.data(), binary_magic.size());
+    for (auto key : keys) {
+        std::array<char, 6> record;
+        for (auto i = 0uz; i < record.size(); i++) {
+            record[i] = static_cast<char>(key >> (40 - 8 * i));
+        }
+        ofs.write(record.data(), record.size());
+    }
+    if (!ofs) {
+        throw std::runtime_error("Can't write file.");
+    }
+    return keys.size();
+}
+
+} // namespace nfcpp::mifare
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <set>
+#include <string_view>
+#include <vector>
+
+#include "common/mapped_file.h"
+
+namespace nfcpp::mifare {
+
+// Keys from the command line and from dictionary files, in one of two formats:
+// - Text, one key per line in 12 hex digits, '#' starts a comment.
+// - Binary, binary_magic followed by 6-byte big-endian keys sorted ascending
+//   without duplicates. These are used in place and never copied.
+class KeyDictionary {
+public:
+    static constexpr std::string_view binary_magic = "MFKEYS48";
+
+    void add(std::uint64_t key) { m_keys.push_back(key); }
+
+    void add(std::span<const std::uint64_t> keys) { m_keys.append_range(keys); }
+
+    // The format is told apart by binary_magic.
+    void load(const std::filesystem::path& path);
+
+    // Drops the duplicated keys from the command line and text dictionaries,
+    // and those in known or in a binary dictionary. Binary dictionaries are
+    // used as they are, a key in two of them (or in known) is kept.
+    void dedup(const std::set<std::uint64_t>& known = {});
+
+    std::size_t size() const;
+
+    std::uint64_t operator[](std::size_t index) const;
+
+    // Writes every key into a single binary dictionary, without duplicates.
+    // Returns how many keys were written.
+    std::size_t save(const std::filesystem::path& path) const;
+
+private:
+    struct BinaryFile {
+        util::MappedFile              file;
+        std::span<const std::uint8_t> records;
+
+        std::size_t size() const { return records.size() / 6; }
+
+        std::uint64_t operator[](std::size_t index) const;
+
+        bool contains(std::uint64_t key) const;
+    };
+
+    std::vector<std::uint64_t> m_keys;
+    std::vector<BinaryFile>    m_files;
+};
+
+} // namespace nfcpp::mifare
@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include "common/local_socket.h"
+
+#include <format>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace nfcpp::util {
+
+#ifdef _WIN32
+
+LocalConnection::~LocalConnection() = default;
+
+std::optional<std::string> LocalConnection::read_line() { return std::nullopt; }
+
+bool LocalConnection::write(std::string_view) { return false; }
+
+LocalServer::LocalServer(std::filesystem::path path) : m_path(std::move(path)) {
+    throw std::runtime_error("UNIX sockets are not supported on Windows.");
+}
+
+LocalServer::~LocalServer() = default;
+
+LocalConnection LocalServer::accept() { return LocalConnection(-1); }
+
+#else
+
+namespace {
+
+// A client that never ends its line is not one.
+constexpr std::size_t max_line = 64 * 1024;
+
+// macOS has SO_NOSIGPIPE on the socket instead.
+#ifdef MSG_NOSIGNAL
+constexpr int send_flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+#else
+constexpr int send_flags = MSG_DONTWAIT;
+#endif
+
+// Removes path if it is a socket, false if there is anything else.
+bool remove_socket(const std::filesystem::path& path) {
+    struct stat status{};
+    if (lstat(path.c_str(), &status) < 0) return errno == ENOENT;
+    if (!S_ISSOCK(status.st_mode)) return false;
+    return unlink(path.c_str()) == 0 || errno == ENOENT;
+}
+
+} // namespace
+
+LocalConnection::~LocalConnection() {
+    if (m_fd >= 0) close(m_fd);
+}
+
+std::optional<std::string> LocalConnection::read_line() {
+    while (true) {
+        auto end = m_buffer.find('\n');
+        if (end != std::string::npos) {
+            auto ret = m_buffer.substr(0, end);
+            m_buffer.erase(0, end + 1);
+            if (ret.ends_with('\r')) ret.pop_back();
+            return ret;
+        }
+        if (m_buffer.size() > max_line) return std::nullopt;
+
+        char buffer[4096];
+        auto size = recv(m_fd, buffer, sizeof(buffer), 0);
+        if (size < 0 && errno == EINTR) continue;
+        if (size <= 0) return std::nullopt;
+        m_buffer.append(buffer, size);
+    }
+}
+
+bool LocalConnection::write(std::string_view data) {
+    while (!data.empty()) {
+        auto size = send(m_fd, data.data(), data.size(), send_flags);
+        if (size < 0 && errno == EINTR) continue;
+        if (size <= 0) {
+            // Also when it stopped reading, the reads see it hang up.
+            shutdown(m_fd, SHUT_RDWR);
+            return false;
+        }
+        data.remove_prefix(size);
+    }
+    return true;
+}
+
+LocalServer::LocalServer(std::filesystem::path path) : m_path(std::move(path)) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (m_path.native().size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("The socket path is too long.");
+    }
+    std::strcpy(address.sun_path, m_path.c_str());
+
+    // Never anything but a stale socket of an earlier run.
+    if (!remove_socket(m_path)) {
+        throw std::runtime_error(std::format(
+            "{} exists and is not a socket.",
+            m_path.string()
+        ));
+    }
+    m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_fd < 0) {
+        throw std::runtime_error("Can't create socket.");
+    }
+    if (bind(m_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+        || listen(m_fd, 16) < 0) {
+        close(m_fd);
+        throw std::runtime_error(
+            std::format("Can't listen on {}.", m_path.string())
+        );
+    }
+}
+
+LocalServer::~LocalServer() {
+    close(m_fd);
+    remove_socket(m_path);
+}
+
+LocalConnection LocalServer::accept() {
+    while (true) {
+        auto fd = ::accept(m_fd, nullptr, nullptr);
+        if (fd >= 0) {
+#ifdef SO_NOSIGPIPE
+            int on = 1;
+            setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+            return LocalConnection(fd);
+        }
+        if (errno != EINTR && errno != ECONNABORTED) {
+            throw std::runtime_error("Can't accept connection.");
+        }
+    }
+}
+
+#endif
+
+} // namespace nfcpp::util
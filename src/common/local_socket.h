@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace nfcpp::util {
+
+// One client of a LocalServer, talking in lines.
+class LocalConnection {
+public:
+    explicit LocalConnection(int fd) : m_fd(fd) {}
+
+    LocalConnection(LocalConnection&& other) noexcept
+    : m_fd(std::exchange(other.m_fd, -1)),
+      m_buffer(std::move(other.m_buffer)) {}
+
+    LocalConnection& operator=(LocalConnection&& other) noexcept {
+        std::swap(m_fd, other.m_fd);
+        std::swap(m_buffer, other.m_buffer);
+        return *this;
+    }
+
+    ~LocalConnection();
+
+    // Without the newline, std::nullopt once the client hung up.
+    std::optional<std::string> read_line();
+
+    // Never blocks, a client that does not keep up with reading is dropped.
+    // Returns false if the client is gone.
+    bool write(std::string_view data);
+
+private:
+    int         m_fd;
+    std::string m_buffer;
+};
+
+// Listens on a UNIX domain socket, a stale socket file at path is replaced
+// and the file is removed again on destruction. Throws std::runtime_error if
+// path is anything but a socket, which is left alone.
+class LocalServer {
+public:
+    explicit LocalServer(std::filesystem::path path);
+
+    LocalServer(const LocalServer&)            = delete;
+    LocalServer& operator=(const LocalServer&) = delete;
+
+    ~LocalServer();
+
+    // Blocks until a client connects.
+    LocalConnection accept();
+
+private:
+    std::filesystem::path m_path;
+    int                   m_fd{-1};
+};
+
+} // namespace nfcpp::util
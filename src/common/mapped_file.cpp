@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include "common/mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nfcpp::util {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+    auto file = CreateFileW(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Can't open file.");
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw std::runtime_error("Can't open file.");
+    }
+    m_size = static_cast<std::size_t>(size.QuadPart);
+
+    // An empty file can't be mapped, it is just an empty view.
+    if (m_size) {
+        auto mapping =
+            CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            m_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+    if (m_size && !m_data) {
+        throw std::runtime_error("Can't map file.");
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (m_data) UnmapViewOfFile(m_data);
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+    auto fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Can't open file.");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        throw std::runtime_error("Can't open file.");
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+
+    // An empty file can't be mapped, it is just an empty view.
+    if (m_size) {
+        m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m_data == MAP_FAILED) m_data = nullptr;
+    }
+    close(fd);
+    if (m_size && !m_data) {
+        throw std::runtime_error("Can't map file.");
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (m_data) munmap(m_data, m_size);
+}
+
+#endif
+
+} // namespace nfcpp::util
@@ -5,6 +5,7 @@
  */
 
 #include "common/mifare_dumper.h"
+#include "common/mifare_key_tester.h"
 
 #include "utility.h"
 
@@ -86,25 +87,26 @@ private:
 
 std::vector<std::uint8_t> MifareClassicDumper::dump() {
     std::vector<std::uint8_t> ret;
-    MifareCrypto1Cipher       cipher;
+    Crypto1State              cipher{};
 
     for (auto start_block : start_block_sequence(m_type)) {
-        ret.append_range(dump_sector(cipher, start_block));
+        // A sector is read again as a whole if the tag leaves in between.
+        ret.append_range(m_initiator.retry_on_loss(m_card, [&] {
+            return dump_sector(cipher, start_block);
+        }));
     }
 
     return ret;
 }
 
 std::uint64_t MifareClassicDumper::test_key_for_block(
-    MifareCrypto1Cipher& cipher,
-    MifareKey            key_type,
-    std::uint8_t         block
+    Crypto1State& cipher,
+    MifareKey     key_type,
+    std::uint8_t  block
 ) {
+    MifareKeyTester tester(m_initiator, m_card);
     for (auto key : m_keys) {
-        if (!m_initiator.select_card(m_card.uid)) {
-            throw std::runtime_error("Tag moved out.");
-        }
-        if (m_initiator.test_key(cipher, key_type, m_card, block, key)) {
+        if (tester.test_key(cipher, key_type, block, key)) {
             return key;
         }
     }
@@ -114,8 +116,8 @@ std::uint64_t MifareClassicDumper::test_key_for_block(
 }
 
 std::vector<std::uint8_t> MifareClassicDumper::dump_sector(
-    MifareCrypto1Cipher& cipher,
-    std::uint8_t         start_block
+    Crypto1State& cipher,
+    std::uint8_t  start_block
 ) {
     const std::uint8_t data_blocks   = start_block < 128 ? 3 : 15;
     const std::uint8_t trailer_block = start_block + data_blocks;
@@ -27,13 +27,13 @@ public:
 
 private:
     std::uint64_t test_key_for_block(
-        MifareCrypto1Cipher& cipher,
-        MifareKey            key_type,
-        std::uint8_t         block
+        Crypto1State& cipher,
+        MifareKey     key_type,
+        std::uint8_t  block
     );
 
     std::vector<std::uint8_t>
-    dump_sector(MifareCrypto1Cipher& cipher, std::uint8_t start_block);
+    dump_sector(Crypto1State& cipher, std::uint8_t start_block);
 
 private:
     MifareClassicInitiator& m_initiator;
@@ -4,7 +4,12 @@
  * This file is part of the NFC++ open source project.
  */
 
+#include <thread>
+
 #include "common/mifare_initiator.h"
+#include "common/event_log.h"
+#include "common/frame_table.h"
+#include "common/mifare_key_tester.h"
 
 #include "utility.h"
 
@@ -14,74 +19,73 @@ namespace {
 
 using namespace util;
 
-template <std::size_t N>
-using data = NfcTransmitData<N>;
-
-template <std::size_t N>
-using data_parity = NfcTransmitDataAutoParity<N>;
-
-template <std::size_t N>
-using data_crc_parity = NfcTransmitDataAutoCRCParity<N, NfcCRC::ISO14443A>;
+// Anything else, e.g. a 4-bit NACK, is reported like a malformed answer.
+RawFrame expect_bits(RawFrame frame, std::size_t bits) {
+    if (frame.bits != bits) {
+        throw_nfc_error(NfcError::INVARG);
+    }
+    return frame;
+}
 
+// Runs the anticollision unless the SELECT frames of the UID are given.
 ISO14443ACard iso14443a_select_card(
-    NfcDevice::Initiator&               initiator,
-    NfcPN53xFrameBuffer&                buffer,
-    const std::span<const std::uint8_t> uid  = {},
-    bool                                wupa = true
+    Transport&                  transport,
+    FrameStats*                 stats,
+    const frames::SelectFrames* select_frames = nullptr,
+    bool                        wupa          = true
 ) {
     ISO14443ACard ret;
-    ret.atqa = initiator.transceive_bits(data(wupa ? 0x52 : 0x26), buffer, 7)
-                   .expect_bytes<2>();
+
+    auto select_transceive = [&](const RawFrame& frame) {
+        return transceive(transport, stats, FrameOp::select, frame);
+    };
+
+    auto atqa =
+        expect_bits(select_transceive(wupa ? frames::wupa : frames::reqa), 16);
+    std::ranges::copy(atqa.data(), ret.atqa.begin());
 
     constexpr auto cascade_bit   = 0x04;
-    auto           cascade_level = 0x93;
+    std::uint8_t   cascade_level = 0x93;
 
-    auto                        uid_known = !uid.empty();
+    auto                        uid_known = select_frames != nullptr;
     std::array<std::uint8_t, 4> uid_buf{};
-    auto                        uid_sent_size = 0;
 
-    while (true) {
+    for (auto level = 0uz;; level++) {
+        RawFrame select;
         if (!uid_known) {
-            auto anticol = initiator.transceive_bits(
-                data_parity(cascade_level, 0x20),
-                buffer
+            auto anticol = expect_bits(
+                select_transceive(make_frame({cascade_level, 0x20}, false)),
+                40
             );
-            if (!anticol.check_bcc()) {
+            std::ranges::copy(anticol.data().first(4), uid_buf.begin());
+            if (util::bcc(uid_buf) != anticol.bytes[4]) {
                 std::println("!!! warning: BCC check failed!");
             }
-            std::ranges::copy(anticol.get_bytes_view<4>(), uid_buf.begin());
+            std::uint8_t bcc = util::bcc(uid_buf);
+
+            select = make_frame(
+                {cascade_level,
+                 0x70,
+                 uid_buf[0],
+                 uid_buf[1],
+                 uid_buf[2],
+                 uid_buf[3],
+                 bcc},
+                true
+            );
         } else {
-            if (uid.size() <= 4) {
-                std::ranges::copy(uid, uid_buf.begin());
-            } else {
-                if (uid.size() - uid_sent_size > 4) {
-                    uid_buf = {
-                        0x88,
-                        uid[uid_sent_size + 0],
-                        uid[uid_sent_size + 1],
-                        uid[uid_sent_size + 2]
-                    };
-                    uid_sent_size += 3;
-                } else {
-                    uid_buf = {
-                        uid[uid_sent_size + 0],
-                        uid[uid_sent_size + 1],
-                        uid[uid_sent_size + 2],
-                        uid[uid_sent_size + 3]
-                    };
-                    uid_sent_size += 4;
-                }
+            if (level >= select_frames->levels) {
+                throw std::runtime_error("Too many cascading levels.");
             }
+            select = select_frames->frames[level];
+            std::ranges::copy(select.data().subspan(2, 4), uid_buf.begin());
         }
-        auto bcc = util::bcc(uid_buf);
-        auto sak = initiator.transceive_bits(
-            data_crc_parity(cascade_level, 0x70, uid_buf, bcc),
-            buffer
-        );
-        if (!sak.check_crc<NfcCRC::ISO14443A>()) {
+
+        auto sak = expect_bits(select_transceive(select), 24);
+        if (!check_crc(sak)) {
             std::println("!!! warning: CRC check failed!");
         }
-        if (sak.get_byte<0>() & cascade_bit) {
+        if (sak.bytes[0] & cascade_bit) {
             if (cascade_level == 0x93) cascade_level = 0x95;
             else if (cascade_level == 0x95) cascade_level = 0x97;
             else {
@@ -90,7 +94,7 @@ ISO14443ACard iso14443a_select_card(
             ret.uid.append_range(std::span(uid_buf).last(3));
         } else {
             ret.uid.append_range(std::span(uid_buf).first(4));
-            ret.sak = sak.get_byte<0>();
+            ret.sak = sak.bytes[0];
             break;
         }
     }
@@ -108,7 +112,11 @@ std::optional<ISO14443ACard>
 MifareClassicInitiator::select_card(const std::span<const std::uint8_t> uid) {
     try {
         hlta();
-        return iso14443a_select_card(m_initiator, m_buffer, uid);
+        return iso14443a_select_card(
+            m_transport,
+            m_stats,
+            uid.empty() ? nullptr : &select_frames_of(uid)
+        );
     } catch (const NfcException& e) {
         if (e.error_code() == NfcError::RFTRANS) {
             return {};
@@ -117,8 +125,17 @@ MifareClassicInitiator::select_card(const std::span<const std::uint8_t> uid) {
     }
 }
 
+const frames::SelectFrames&
+MifareClassicInitiator::select_frames_of(std::span<const std::uint8_t> uid) {
+    if (!std::ranges::equal(uid, m_select_uid)) {
+        m_select_frames = frames::make_select_frames(uid);
+        m_select_uid.assign(uid.begin(), uid.end());
+    }
+    return m_select_frames;
+}
+
 bool MifareClassicInitiator::auth(
-    MifareCrypto1Cipher&               cipher,
+    Crypto1State&                      cipher,
     MifareKey                          key_type,
     const ISO14443ACard&               card,
     std::uint8_t                       block,
@@ -126,29 +143,14 @@ bool MifareClassicInitiator::auth(
     bool                               nested,
     detail::OptionalRef<std::uint32_t> nonce
 ) {
-    std::uint32_t nt;
-
-    auto cmd = static_cast<mifare_cmd>(key_type);
-
-    if (!nested) {
-        nt = m_initiator.transceive_bits(data_crc_parity(cmd, block), m_buffer)
-                 .as_big_endian()
-                 .expect<std::uint32_t>();
-    } else {
-        nt = m_initiator
-                 .transceive_bits(
-                     data_crc_parity(cmd, block)
-                         .with_encrypt(
-                             cipher,
-                             [](auto&& cipher) { cipher.crypt(4); }
-                         ),
-                     m_buffer
-                 )
-                 .as_big_endian()
-                 .expect<std::uint32_t>();
+    auto request = frames::auth(key_type, block);
+    if (nested) {
+        encrypt_frame(request, cipher);
     }
 
-    cipher.init(key);
+    auto nt = get_u32(expect_bits(transceive(FrameOp::auth, request), 32));
+
+    cipher = Crypto1State::from_key(key);
 
     auto nuid = card.nuid;
 
@@ -162,60 +164,70 @@ bool MifareClassicInitiator::auth(
         nonce->get() = nt;
     }
 
-    std::array<std::uint8_t, 4> nr{};
-    std::array<std::uint8_t, 4> ntt;
+    // nr is left zero, ar = suc^64(nt).
+    std::array<std::uint8_t, 8> nr_ar{};
+    put_u32(std::span(nr_ar).last<4>(), prng_successor(nt, 64));
 
-    nt = prng_successor(nt, 32);
-    for (auto i : std::views::iota(0, 4)) {
-        nt     = prng_successor(nt, 8);
-        ntt[i] = nt & 0xff;
-    }
-
-    auto at_r = m_initiator.transceive_bits(
-        data_parity(nr, ntt).with_encrypt(
-            cipher,
-            [](auto&& cipher) {
-                cipher.crypt_feed(4);
-                cipher.crypt(4);
-            }
-        ),
-        m_buffer
-    );
+    auto reply = make_frame(nr_ar, false);
+    encrypt_frame(reply, cipher, 4);
 
-    auto at = at_r.as_decrypted(cipher, false, false)
-                  .as_big_endian()
-                  .expect<std::uint32_t>();
+    auto at = expect_bits(transceive(FrameOp::auth, reply), 32);
+    decrypt_frame(at, cipher);
 
-    nt = prng_successor(nt, 32);
-
-    return at == nt;
+    return get_u32(at) == prng_successor(nt, 96);
 }
 
-std::array<std::uint8_t, 16> MifareClassicInitiator::read(
-    mifare::MifareCrypto1Cipher& cipher,
-    std::uint8_t                 block
-) {
-    auto response = m_initiator
-                        .transceive_bits(
-                            data_crc_parity(0x30, block)
-                                .with_encrypt(
-                                    cipher,
-                                    [](auto&& cipher) { cipher.crypt(4); }
-                                ),
-                            m_buffer
-                        )
-                        .as_decrypted(cipher, false, false);
-    if (!response.check_crc<NfcCRC::ISO14443A>()) {
+std::array<std::uint8_t, 16>
+MifareClassicInitiator::read(Crypto1State& cipher, std::uint8_t block) {
+    auto request = frames::read[block];
+    encrypt_frame(request, cipher);
+
+    auto response = transceive(FrameOp::read, request);
+    decrypt_frame(response, cipher);
+    if (response.size() != 18 || !check_crc(response)) {
         throw std::runtime_error(
             "CRC check of the returned block data failed."
         );
     }
-    return response.get_bytes<16>();
+
+    std::array<std::uint8_t, 16> ret;
+    std::ranges::copy(response.data().first(16), ret.begin());
+    return ret;
+}
+
+bool MifareClassicInitiator::reselect(
+    std::span<const RawFrame> select_frames,
+    std::uint8_t              sak
+) {
+    constexpr auto cascade_bit = 0x04;
+
+    try {
+        if (transceive(FrameOp::select, frames::wupa).bits != 16) {
+            return false;
+        }
+        for (auto i : std::views::iota(0uz, select_frames.size())) {
+            auto answer = transceive(FrameOp::select, select_frames[i]);
+            if (answer.bits != 24 || !check_crc(answer)) {
+                return false;
+            }
+            auto last = i + 1 == select_frames.size();
+            if (last ? answer.bytes[0] != sak
+                     : !(answer.bytes[0] & cascade_bit)) {
+                return false;
+            }
+        }
+        return true;
+    } catch (const NfcException& e) {
+        if (e.error_code() == NfcError::RFTRANS) {
+            return false;
+        }
+        throw;
+    }
 }
 
 bool MifareClassicInitiator::hlta() {
     try {
-        m_initiator.transceive_bits(data_crc_parity(0x50, 0x00), m_buffer);
+        transceive(FrameOp::hlta, frames::hlta);
         return false;
     } catch (const NfcException& e) {
         if (e.error_code() == NfcError::RFTRANS) {
@@ -225,11 +237,36 @@ bool MifareClassicInitiator::hlta() {
     }
 }
 
+void MifareClassicInitiator::reacquire_card(const ISO14443ACard& card) {
+    using namespace std::chrono;
+
+    if (select_card(card.uid)) return;
+    if (m_reacquire_timeout <= 0ms) {
+        throw TagLostError();
+    }
+
+    std::println("\r\033[2KTag lost, waiting for it to come back...");
+    util::emit_event(m_events, "tag_waiting");
+
+    // Only the same UID answers the SELECT, another tag is ignored.
+    auto deadline = steady_clock::now() + m_reacquire_timeout;
+    auto backoff  = milliseconds(10);
+    while (steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(backoff);
+        if (select_card(card.uid)) {
+            std::println("Tag is back.");
+            util::emit_event(m_events, "tag_back");
+            return;
+        }
+        backoff = std::min(backoff * 2, milliseconds(500));
+    }
+    throw TagLostError();
+}
+
 bool MifareClassicInitiator::try_rats() {
     try {
-        auto ats =
-            m_initiator.transceive_bits(data_crc_parity(0xE0, 0x50), m_buffer);
-        if (ats.size_in_byte() > 3 && ats.check_crc<NfcCRC::ISO14443A>()) {
+        auto ats = transceive(FrameOp::rats, frames::rats);
+        if (ats.size() > 3 && check_crc(ats)) {
             return true;
         }
     } catch (const NfcException& e) {
@@ -241,76 +278,101 @@ bool MifareClassicInitiator::try_rats() {
 }
 
 bool MifareClassicInitiator::test_key(
-    mifare::MifareCrypto1Cipher& cipher,
-    mifare::MifareKey            key_type,
-    const ISO14443ACard&         card,
-    std::uint8_t                 block,
-    std::uint64_t                key
+    Crypto1State&        cipher,
+    MifareKey            key_type,
+    const ISO14443ACard& card,
+    std::uint8_t         block,
+    std::uint64_t        key
 ) {
-    if (!select_card(card.uid)) {
-        throw std::runtime_error("Tag moved out.");
-    }
-    try {
-        if (auth(cipher, key_type, card, block, key, false)) {
-            return true;
-        }
-    } catch (const NfcException& e) {
-        if (e.error_code() != NfcError::RFTRANS
-            // Some tag may NACK.
-            && e.error_code() != NfcError::INVARG) {
-            throw;
+    // A tag that does not even send its nonce is most likely gone, the key is
+    // tested again once it is back.
+    for (auto retried = false;; retried = true) {
+        reacquire_card(card);
+
+        std::uint32_t nt{}; // Never a nonce, the PRNG does not reach 0.
+        try {
+            return auth(cipher, key_type, card, block, key, false, nt);
+        } catch (const NfcException& e) {
+            if (e.error_code() != NfcError::RFTRANS
+                // Some tag may NACK.
+                && e.error_code() != NfcError::INVARG) {
+                throw;
+            }
+            if (nt || e.error_code() != NfcError::RFTRANS || retried) {
+                return false;
+            }
         }
     }
-    return false;
 }
 
 std::uint32_t MifareClassicInitiator::encrypted_nonce(
-    MifareCrypto1Cipher& cipher,
-    MifareKey            key_type,
-    std::uint8_t         block
+    Crypto1State&                     cipher,
+    MifareKey                         key_type,
+    std::uint8_t                      block,
+    detail::OptionalRef<std::uint8_t> parity
 ) {
-    return m_initiator
-        .transceive_bits(
-            data_crc_parity(static_cast<mifare_cmd>(key_type), block)
-                .with_encrypt(cipher, [](auto&& cipher) { cipher.crypt(4); }),
-            m_buffer
-        )
-        .as_big_endian()
-        .expect<std::uint32_t>();
+    auto request = frames::auth(key_type, block);
+    encrypt_frame(request, cipher);
+
+    auto response = expect_bits(transceive(FrameOp::nonce, request), 32);
+
+    // The transport never touches parity, these are the encrypted bits.
+    if (parity) {
+        parity->get() = 0;
+        for (auto i : std::views::iota(0, 4)) {
+            parity->get() |= (response.parity[i] & 1) << i;
+        }
+    }
+
+    return get_u32(response);
 }
 
 std::vector<SectorKey> MifareClassicInitiator::test_default_keys(
     const ISO14443ACard&           card,
     MifareCard                     type,
     std::span<const std::uint64_t> user_keys,
-    bool                           no_default_keys
+    bool                           no_default_keys,
+    bool                           first_key_only,
+    const SectorKeys&              site_keys
 ) {
-    std::vector<std::uint64_t> default_keys = {
-        0xFFFFFFFFFFFF,
-        0xA0A1A2A3A4A5,
-        0xD3F7D3F7D3F7,
-        0x000000000000,
-    };
-    if (no_default_keys) default_keys.clear();
-    default_keys.append_range(user_keys);
+    std::vector<std::uint64_t> keys;
+    if (!no_default_keys) keys.append_range(default_keys);
+    keys.append_range(user_keys);
 
-    std::println("Testing {} default keys...", default_keys.size());
+    if (site_keys) {
+        std::println(
+            "Testing {} default keys after the site keys...",
+            keys.size()
+        );
+    } else {
+        std::println("Testing {} default keys...", keys.size());
+    }
 
     std::vector<SectorKey> ret;
-    MifareCrypto1Cipher    cipher;
+    Crypto1State           cipher{};
+    MifareKeyTester        tester(*this, card);
 
     std::println("{:<6} {:<12} {:<12}", "Sector", "KeyA", "KeyB");
 
     for (auto block : start_block_sequence(type)) {
+        // The site keys first, as ranked for this sector.
+        std::vector<std::uint64_t> sector_keys;
+        if (site_keys) sector_keys = site_keys(block_to_sector(block));
+        for (auto key : keys) {
+            if (std::ranges::find(sector_keys, key) == sector_keys.end()) {
+                sector_keys.push_back(key);
+            }
+        }
+
         std::optional<uint64_t> key_a, key_b;
-        for (auto key : default_keys) {
+        for (auto key : sector_keys) {
             if (key_a && key_b) {
                 break;
             }
-            if (!key_a && test_key(cipher, MifareKey::A, card, block, key)) {
+            if (!key_a && tester.test_key(cipher, MifareKey::A, block, key)) {
                 key_a = key;
             }
-            if (!key_b && test_key(cipher, MifareKey::B, card, block, key)) {
+            if (!key_b && tester.test_key(cipher, MifareKey::B, block, key)) {
                 key_b = key;
             }
         }
@@ -321,6 +383,7 @@ std::vector<SectorKey> MifareClassicInitiator::test_default_keys(
             key_a ? std::format("{:012X}", *key_a) : "-",
             key_b ? std::format("{:012X}", *key_b) : "-"
         );
+        if (first_key_only && (key_a || key_b)) break;
     }
 
     return ret;
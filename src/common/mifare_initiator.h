@@ -6,23 +6,56 @@
 
 #pragma once
 
-#include <nfcpp/nfc.hpp>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+
+#include "common/frame_stats.h"
+#include "common/frame_table.h"
+#include "common/transport.h"
 
 #include "types.h"
 
 namespace nfcpp::mifare {
 
+// The tag no longer answers to SELECT, most likely it was taken away.
+class TagLostError : public std::runtime_error {
+public:
+    TagLostError() : std::runtime_error("Tag moved out.") {}
+};
+
+inline constexpr std::array<std::uint64_t, 4> default_keys = {
+    0xFFFFFFFFFFFF,
+    0xA0A1A2A3A4A5,
+    0xD3F7D3F7D3F7,
+    0x000000000000,
+};
+
 class MifareClassicInitiator {
 public:
-    explicit MifareClassicInitiator(NfcDevice::Initiator& initiator)
-    : m_initiator(initiator) {}
+    // The keys to try first in a sector, in order.
+    using SectorKeys = std::function<std::vector<std::uint64_t>(std::uint8_t)>;
+
+    explicit MifareClassicInitiator(Transport& transport)
+    : m_transport(transport) {}
+
+    // Times every frame into stats from now on, nullptr to stop.
+    void set_frame_stats(FrameStats* stats) { m_stats = stats; }
+
+    // How long reacquire_card() waits for a lost tag, 0 = not at all.
+    void set_reacquire_timeout(std::chrono::milliseconds timeout) {
+        m_reacquire_timeout = timeout;
+    }
+
+    // Where reacquire_card() reports a lost tag, nullptr for nowhere.
+    void set_events(util::EventLog* events) { m_events = events; }
 
     std::optional<ISO14443ACard>
     select_card(const std::span<const std::uint8_t> uid = {});
 
     bool auth(
-        mifare::MifareCrypto1Cipher&       cipher,
-        mifare::MifareKey                  key_type,
+        Crypto1State&                      cipher,
+        MifareKey                          key_type,
         const ISO14443ACard&               card,
         std::uint8_t                       block,
         std::uint64_t                      key,
@@ -30,37 +63,84 @@ public:
         detail::OptionalRef<std::uint32_t> nonce = std::nullopt
     );
 
-    std::array<std::uint8_t, 16>
-    read(mifare::MifareCrypto1Cipher& cipher, std::uint8_t block);
+    std::array<std::uint8_t, 16> read(Crypto1State& cipher, std::uint8_t block);
+
+    // WUPA and SELECT with frames built beforehand, for a tag that is known to
+    // wait in IDLE or HALT. Returns false if it did not answer as expected.
+    bool reselect(std::span<const RawFrame> select_frames, std::uint8_t sak);
 
     bool hlta();
 
+    // select_card(card.uid), but a tag that does not answer is polled for
+    // with backoff until it comes back. Throws TagLostError after the
+    // reacquire timeout.
+    void reacquire_card(const ISO14443ACard& card);
+
+    // Runs step again while the tag stops answering in the middle of it, after
+    // reacquire_card(). Only for steps where a missing answer can't mean a
+    // wrong key or the like.
+    template <typename Step>
+    decltype(auto) retry_on_loss(const ISO14443ACard& card, Step&& step) {
+        for (auto retries = 0uz;; retries++) {
+            try {
+                return step();
+            } catch (const NfcException& e) {
+                if (e.error_code() != NfcError::RFTRANS
+                    || retries == max_step_retries) {
+                    throw;
+                }
+            }
+            reacquire_card(card);
+        }
+    }
+
     bool try_rats();
 
     bool test_key(
-        mifare::MifareCrypto1Cipher& cipher,
-        mifare::MifareKey            key_type,
-        const ISO14443ACard&         card,
-        std::uint8_t                 block,
-        std::uint64_t                key
+        Crypto1State&        cipher,
+        MifareKey            key_type,
+        const ISO14443ACard& card,
+        std::uint8_t         block,
+        std::uint64_t        key
     );
 
     std::uint32_t encrypted_nonce(
-        mifare::MifareCrypto1Cipher& cipher,
-        mifare::MifareKey            key_type,
-        std::uint8_t                 block
+        Crypto1State&                     cipher,
+        MifareKey                         key_type,
+        std::uint8_t                      block,
+        detail::OptionalRef<std::uint8_t> parity = std::nullopt
     );
 
+    // Stops after the first sector with a valid key if first_key_only, the
+    // sectors after it are left out of the result. The keys of site_keys are
+    // tried first.
     std::vector<SectorKey> test_default_keys(
         const ISO14443ACard&           card,
         MifareCard                     type,
         std::span<const std::uint64_t> user_keys       = {},
-        bool                           no_default_keys = false
+        bool                           no_default_keys = false,
+        bool                           first_key_only  = false,
+        const SectorKeys&              site_keys       = {}
     );
 
 private:
-    NfcDevice::Initiator& m_initiator;
-    NfcPN53xFrameBuffer   m_buffer;
+    static constexpr std::size_t max_step_retries = 3;
+
+    RawFrame transceive(FrameOp op, const RawFrame& frame) {
+        return mifare::transceive(m_transport, m_stats, op, frame);
+    }
+
+    // Built once for the UID selected last, select_card() mostly sees the
+    // same card again.
+    const frames::SelectFrames&
+    select_frames_of(std::span<const std::uint8_t> uid);
+
+    Transport&                m_transport;
+    FrameStats*               m_stats{};
+    util::EventLog*           m_events{};
+    std::chrono::milliseconds m_reacquire_timeout{};
+    std::vector<std::uint8_t> m_select_uid;
+    frames::SelectFrames      m_select_frames;
 };
 
 } // namespace nfcpp::mifare
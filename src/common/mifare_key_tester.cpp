@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include "common/mifare_key_tester.h"
+
+#include "utility.h"
+
+namespace nfcpp::mifare {
+
+namespace {
+
+// Auths a selected tag may leave without a nonce before it counts as lost.
+constexpr std::size_t max_mute_auths = 3;
+
+} // namespace
+
+MifareKeyTester::MifareKeyTester(
+    MifareClassicInitiator& initiator,
+    const ISO14443ACard&    card
+)
+: m_initiator(initiator),
+  m_card(card),
+  m_select_frames(frames::make_select_frames(card.uid)) {}
+
+bool MifareKeyTester::select() {
+    if (std::exchange(m_idle, false)
+        && m_initiator.reselect(m_select_frames.view(), m_card.sak)) {
+        return true;
+    }
+    // Unknown state, or the shortcut failed: take the long way.
+    return m_initiator.select_card(m_card.uid).has_value();
+}
+
+bool MifareKeyTester::test_key(
+    Crypto1State& cipher,
+    MifareKey     key_type,
+    std::uint8_t  block,
+    std::uint64_t key
+) {
+    for (auto mute = 0uz;;) {
+        if (!std::exchange(m_selected, false) && !select()) {
+            m_initiator.reacquire_card(m_card);
+        }
+
+        std::uint32_t nt{}; // Never a nonce, the PRNG does not reach 0.
+        auto          nacked = false;
+        try {
+            // The tag answered, so it is authenticated (or confused) and will
+            // not take a WUPA.
+            return m_initiator
+                .auth(cipher, key_type, m_card, block, key, false, nt);
+        } catch (const NfcException& e) {
+            if (e.error_code() != NfcError::RFTRANS
+                // Some tag may NACK.
+                && e.error_code() != NfcError::INVARG) {
+                throw;
+            }
+            nacked = e.error_code() == NfcError::INVARG;
+        }
+        // No answer or a NACK, the tag went back to IDLE (or HALT).
+        m_idle = true;
+        if (nacked) return false;
+        // Silence after the nonce is a wrong key, unless the tag left right
+        // then. It still answers SELECT if not, which the next test needs
+        // anyway. A tag that left gets the key again once it is back, until
+        // reacquire_card() gives up on it.
+        m_selected = select();
+        if (nt && m_selected) return false;
+        // Still there but no nonce either, that is no answer about the key.
+        if (m_selected && ++mute == max_mute_auths) {
+            throw_nfc_error(NfcError::RFTRANS);
+        }
+    }
+}
+
+} // namespace nfcpp::mifare
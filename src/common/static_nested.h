@@ -6,12 +6,64 @@
 
 #pragma once
 
+#include <stop_token>
+
 #include "common/mifare_initiator.h"
 
 #include "types.h"
 
 namespace nfcpp::static_nested {
 
+// Measures the nested distances of depth auth chains samples times and takes
+// the mode of every depth, broken or non-monotonic chains are thrown away.
+NonceCalibration calibrate(
+    mifare::MifareClassicInitiator& mf_initiator,
+    const ISO14443ACard&            card,
+    std::uint8_t                    block,
+    mifare::MifareKey               key_type,
+    std::uint64_t                   key,
+    std::size_t                     depth,
+    std::size_t                     samples
+);
+
+// Batched building blocks of execute(): the nonces of every target can be
+// captured first, cracked offline in parallel and tested on air afterwards.
+
+// Collects the nonces again while they fail the sanity checks, up to
+// options.max_retries times or until the same nonces come back.
+std::vector<EncryptedNonce> capture(
+    mifare::MifareClassicInitiator& mf_initiator,
+    const ISO14443ACard&            card,
+    std::uint8_t                    block,
+    mifare::MifareKey               key_type,
+    std::uint64_t                   key,
+    std::uint8_t                    target_block,
+    mifare::MifareKey               target_key_type,
+    const NonceCalibration&         calibration,
+    const StaticNestedOptions&      options = {}
+);
+
+// Candidate keys that match the extra nonces, std::nullopt if the set is
+// empty or larger than options.max_candidates.
+std::optional<std::vector<std::uint64_t>> recover_filtered_candidates(
+    std::span<const EncryptedNonce> nt_encs,
+    std::uint32_t                   nuid,
+    const StaticNestedOptions&      options = {},
+    std::stop_token                 token   = {}
+);
+
+StaticNestedResult test_candidates(
+    mifare::MifareClassicInitiator& mf_initiator,
+    const ISO14443ACard&            card,
+    std::uint8_t                    target_block,
+    mifare::MifareKey               target_key_type,
+    std::span<const std::uint64_t>  candidates,
+    const StaticNestedOptions&      options = {}
+);
+
+// The first attempt uses the captured nonces instead, if any. With
+// options.checkpoint, an interrupted sweep of the target is resumed from it.
+// The candidates are tested on options.helpers as well.
 StaticNestedResult execute(
     mifare::MifareClassicInitiator& mf_initiator,
     const ISO14443ACard&            card,
@@ -20,7 +72,9 @@ StaticNestedResult execute(
     std::uint64_t                   key,
     std::uint8_t                    target_block,
     mifare::MifareKey               target_key_type,
-    bool                            force_detect_distance = false
+    const NonceCalibration&         calibration,
+    const StaticNestedOptions&      options  = {},
+    std::span<const EncryptedNonce> captured = {}
 );
 
 } // namespace nfcpp::static_nested
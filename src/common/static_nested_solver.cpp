@@ -0,0 +1,303 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include <future>
+#include <map>
+#include <mutex>
+#include <numeric>
+
+#include "common/crypto1.h"
+#include "common/iso14443a_frame.h"
+#include "common/static_nested_solver.h"
+
+#include "utility.h"
+
+namespace nfcpp::static_nested {
+
+using namespace mifare;
+
+namespace {
+
+constexpr auto cluster_count = 1uz << 16;
+
+// Bits 16..23 of both halves are the oldest 16 bits of the LFSR, which are
+// still part of the key after rolling back 32 bits.
+constexpr std::uint16_t rollback_key(std::uint32_t odd, std::uint32_t even) {
+    return ((even >> 8) & 0xff00) | ((odd >> 16) & 0x00ff);
+}
+
+// The parity bit of byte i is encrypted with the keystream bit following it,
+// in transmission order that is bit 8 * (i + 1) of the keystream.
+bool parity_keystream_bit(const EncryptedNonce& nt_enc, std::size_t i) {
+    auto plain_byte = static_cast<std::uint8_t>(nt_enc.nonce >> (24 - 8 * i));
+    return ((*nt_enc.parity >> i) & 1) ^ odd_parity8(plain_byte);
+}
+
+} // namespace
+
+bool check_nonce_parity(const EncryptedNonce& nt_enc) {
+    if (!nt_enc.parity) return false;
+    for (auto i : std::views::iota(0uz, 3uz)) {
+        auto ks_bit = (nt_enc.keystream >> ((8 * (i + 1)) ^ 24)) & 1;
+        if (parity_keystream_bit(nt_enc, i) != ks_bit) return false;
+    }
+    return true;
+}
+
+PartitionedStates
+recovery_partition(const EncryptedNonce& nt_enc, std::uint32_t nuid) {
+    PartitionedStates ret;
+    ret.offsets.assign(cluster_count + 1, 0);
+
+    auto recovered =
+        MifareCrypto1Cipher::recovery32(nt_enc.keystream, nt_enc.nonce ^ nuid);
+    if (!recovered) return ret;
+
+    // The last parity bit is encrypted with keystream bit 32, which is the
+    // filter output of the recovered state itself.
+    if (check_nonce_parity(nt_enc)) {
+        auto ks_bit = parity_keystream_bit(nt_enc, 3);
+        std::erase_if(*recovered, [&](const auto& state) {
+            return Crypto1State::filter(state.odd()) != ks_bit;
+        });
+    }
+
+    // Counting sort straight into the packed storage, this is the only copy
+    // the recovered states ever get.
+    for (auto& state : *recovered) {
+        ret.offsets[rollback_key(state.odd(), state.even()) + 1]++;
+    }
+    std::inclusive_scan(
+        ret.offsets.begin(),
+        ret.offsets.end(),
+        ret.offsets.begin()
+    );
+
+    auto cursor = ret.offsets;
+    ret.states.resize(recovered->size());
+    for (auto& state : *recovered) {
+        auto key    = rollback_key(state.odd(), state.even());
+        auto packed = Crypto1State{state.odd(), state.even()}.pack();
+        ret.states[cursor[key]++] = packed;
+    }
+
+    return ret;
+}
+
+std::vector<ClusterPair>
+pair_clusters(PartitionedStates& states_a, PartitionedStates& states_b) {
+    std::vector<ClusterPair> ret;
+
+    auto cluster = [](PartitionedStates& states, std::size_t key) {
+        return std::span(states.states)
+            .subspan(
+                states.offsets[key],
+                states.offsets[key + 1] - states.offsets[key]
+            );
+    };
+
+    for (auto key : std::views::iota(0uz, cluster_count)) {
+        auto cluster_a = cluster(states_a, key);
+        auto cluster_b = cluster(states_b, key);
+        if (!cluster_a.empty() && !cluster_b.empty()) {
+            ret.emplace_back(cluster_a, cluster_b);
+        }
+    }
+
+    return ret;
+}
+
+void rollback_paired_states(
+    std::span<const ClusterPair> clusters,
+    const EncryptedNonce&        nt_enc_a,
+    const EncryptedNonce&        nt_enc_b,
+    std::uint32_t                nuid,
+    std::size_t                  threads
+) {
+    auto rollback = [](std::span<std::uint64_t> states, std::uint32_t in) {
+        for (auto& packed : states) {
+            auto state = Crypto1State::unpack(packed);
+            state.rollback_word(in, false);
+            packed = state.pack();
+        }
+    };
+
+    util::parallel_for(
+        clusters.size(),
+        threads,
+        256,
+        [&](auto begin, auto end) {
+            for (auto& cluster : clusters.subspan(begin, end - begin)) {
+                rollback(cluster.states_a, nt_enc_a.nonce ^ nuid);
+                rollback(cluster.states_b, nt_enc_b.nonce ^ nuid);
+            }
+        }
+    );
+}
+
+std::vector<std::uint64_t>
+find_intersection(std::span<const ClusterPair> clusters, std::size_t threads) {
+    constexpr auto grain = 256uz;
+
+    // One output per chunk, so the result order does not depend on scheduling.
+    std::vector<std::vector<std::uint64_t>> found(
+        (clusters.size() + grain - 1) / grain
+    );
+
+    util::parallel_for(
+        clusters.size(),
+        threads,
+        grain,
+        [&](auto begin, auto end) {
+            auto&                      out = found[begin / grain];
+            std::vector<std::uint64_t> lookup;
+            for (auto& cluster : clusters.subspan(begin, end - begin)) {
+                auto [smaller, larger] =
+                    cluster.states_a.size() <= cluster.states_b.size()
+                        ? std::pair(cluster.states_a, cluster.states_b)
+                        : std::pair(cluster.states_b, cluster.states_a);
+                // Build the lookup from the smaller side and probe it with
+                // the larger one.
+                lookup.assign_range(smaller);
+                std::ranges::sort(lookup);
+                for (auto state : larger) {
+                    if (std::ranges::binary_search(lookup, state)) {
+                        out.push_back(state);
+                    }
+                }
+            }
+        }
+    );
+
+    return found | std::views::join | std::ranges::to<std::vector>();
+}
+
+namespace {
+
+auto recovery_partition_pair(
+    std::span<const EncryptedNonce, 2> nt_encs,
+    std::uint32_t                      nuid
+) {
+    // recovery32 itself is sequential, so run both recoveries side by side.
+    auto future_states_a = std::async(
+        std::launch::async,
+        recovery_partition,
+        nt_encs[0],
+        nuid
+    );
+    auto future_states_b = std::async(
+        std::launch::async,
+        recovery_partition,
+        nt_encs[1],
+        nuid
+    );
+    return std::pair(future_states_a.get(), future_states_b.get());
+}
+
+} // namespace
+
+std::vector<std::uint64_t> recover_candidates(
+    std::span<const EncryptedNonce, 2> nt_encs,
+    std::uint32_t                      nuid,
+    std::size_t                        threads
+) {
+    threads = util::resolve_threads(threads);
+
+    auto [states_a, states_b] = recovery_partition_pair(nt_encs, nuid);
+
+    auto clusters = pair_clusters(states_a, states_b);
+    rollback_paired_states(clusters, nt_encs[0], nt_encs[1], nuid, threads);
+
+    return find_intersection(clusters, threads);
+}
+
+void stream_candidates(
+    std::span<const EncryptedNonce, 2> nt_encs,
+    std::uint32_t                      nuid,
+    std::size_t                        threads,
+    const std::function<bool(std::span<const std::uint64_t>)>& sink
+) {
+    threads = util::resolve_threads(threads);
+
+    auto [states_a, states_b] = recovery_partition_pair(nt_encs, nuid);
+
+    auto clusters = pair_clusters(states_a, states_b);
+
+    // Rollback and join chunk by chunk instead of phase by phase, so the first
+    // candidates come out right after the recovery. Whatever order the chunks
+    // finish in, they reach sink in cluster order, so the keys tested on air
+    // do not depend on the thread timing (a trace replays).
+    using Finished = std::pair<std::size_t, std::vector<std::uint64_t>>;
+
+    std::atomic<bool>               stopped{};
+    std::mutex                      finished_mutex;
+    std::map<std::size_t, Finished> finished;
+    std::size_t                     delivered{};
+    util::parallel_for(
+        clusters.size(),
+        threads,
+        256,
+        [&](auto begin, auto end) {
+            if (stopped.load(std::memory_order_relaxed)) return;
+            auto chunk = std::span(clusters).subspan(begin, end - begin);
+            rollback_paired_states(chunk, nt_encs[0], nt_encs[1], nuid, 1);
+            auto candidates = find_intersection(chunk, 1);
+
+            std::scoped_lock lock(finished_mutex);
+            finished.try_emplace(begin, end, std::move(candidates));
+            for (auto it = finished.begin();
+                 it != finished.end() && it->first == delivered;
+                 it = finished.erase(it)) {
+                delivered = it->second.first;
+                if (!stopped && !sink(it->second.second)) {
+                    stopped.store(true, std::memory_order_relaxed);
+                }
+            }
+        }
+    );
+}
+
+bool verify_key(
+    std::uint64_t                   key,
+    std::span<const EncryptedNonce> nt_encs,
+    std::uint32_t                   nuid
+) {
+    for (auto& nt_enc : nt_encs) {
+        auto state = Crypto1State::from_key(key);
+        if (state.word(nt_enc.nonce ^ nuid, false) != nt_enc.keystream) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::uint64_t> match_dictionary(
+    const KeyDictionary&            keys,
+    std::span<const EncryptedNonce> nt_encs,
+    std::uint32_t                   nuid,
+    std::size_t                     threads
+) {
+    std::vector<std::uint64_t> ret;
+    std::mutex                 ret_mutex;
+    util::parallel_for(
+        keys.size(),
+        util::resolve_threads(threads),
+        4096,
+        [&](auto begin, auto end) {
+            for (auto i = begin; i < end; i++) {
+                auto key = keys[i];
+                if (!verify_key(key, nt_encs, nuid)) continue;
+                std::scoped_lock lock(ret_mutex);
+                ret.push_back(key);
+            }
+        }
+    );
+    // In the same order on every run, not that of the threads.
+    std::ranges::sort(ret);
+    return ret;
+}
+
+} // namespace nfcpp::static_nested
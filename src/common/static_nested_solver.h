@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <functional>
+
+#include <nfcpp/nfc.hpp>
+
+#include "common/key_dictionary.h"
+
+#include "types.h"
+
+namespace nfcpp::static_nested {
+
+// Recovered states packed to 48 bits (see Crypto1State::pack) and bucketed by
+// their 16-bit rollback key, states[offsets[key] .. offsets[key + 1]) all
+// share the same key. Recovery, rollback and the join all work in place on
+// this storage.
+struct PartitionedStates {
+    std::vector<std::uint64_t> states;
+    std::vector<std::uint32_t> offsets;
+};
+
+// A pair of state ranges sharing the same 16-bit rollback key, only states
+// inside the same cluster can roll back to the same key.
+struct ClusterPair {
+    std::span<std::uint64_t> states_a;
+    std::span<std::uint64_t> states_b;
+};
+
+// Checks the three parity bits covered by the keystream itself, a mismatch
+// means the plaintext nonce was mispredicted.
+bool check_nonce_parity(const EncryptedNonce& nt_enc);
+
+PartitionedStates
+recovery_partition(const EncryptedNonce& nt_enc, std::uint32_t nuid);
+
+std::vector<ClusterPair>
+pair_clusters(PartitionedStates& states_a, PartitionedStates& states_b);
+
+void rollback_paired_states(
+    std::span<const ClusterPair> clusters,
+    const EncryptedNonce&        nt_enc_a,
+    const EncryptedNonce&        nt_enc_b,
+    std::uint32_t                nuid,
+    std::size_t                  threads
+);
+
+// Returns the packed states both sides have in common, i.e. candidate keys.
+std::vector<std::uint64_t>
+find_intersection(std::span<const ClusterPair> clusters, std::size_t threads);
+
+// Runs the whole offline phase, threads = 0 means all hardware threads.
+std::vector<std::uint64_t> recover_candidates(
+    std::span<const EncryptedNonce, 2> nt_encs,
+    std::uint32_t                      nuid,
+    std::size_t                        threads = 0
+);
+
+// Same as recover_candidates, but hands the candidates of every chunk of
+// clusters to sink as soon as they and the chunks before are known. Returning
+// false from sink stops the remaining work. sink is called from any of the
+// threads, but one chunk at a time and in cluster order.
+void stream_candidates(
+    std::span<const EncryptedNonce, 2> nt_encs,
+    std::uint32_t                      nuid,
+    std::size_t                        threads,
+    const std::function<bool(std::span<const std::uint64_t>)>& sink
+);
+
+// Checks a key against nonces it was not recovered from, using Crypto1 only.
+bool verify_key(
+    std::uint64_t                   key,
+    std::span<const EncryptedNonce> nt_encs,
+    std::uint32_t                   nuid
+);
+
+// Keys of the dictionary that produce every captured keystream, which on a
+// static nonce tag rules the wrong keys out without touching the reader.
+// Sorted.
+std::vector<std::uint64_t> match_dictionary(
+    const mifare::KeyDictionary&    keys,
+    std::span<const EncryptedNonce> nt_encs,
+    std::uint32_t                   nuid,
+    std::size_t                     threads = 0
+);
+
+} // namespace nfcpp::static_nested
@@ -0,0 +1,338 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include "common/sweep_checkpoint.h"
+
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace nfcpp::static_nested {
+
+using namespace mifare;
+
+namespace {
+
+// The file is checkpoint_magic followed by entries, every number is little
+// endian and a key takes 6 bytes. An entry is its size (4 bytes, of what
+// follows), its kind, the target (UID size, UID, block, key type) and:
+// - entry_start: complete, the number of nonces, then the nonces. The sweep
+//   starts over with no candidates tested.
+// - entry_candidates: candidates to append, up to the end of the entry.
+// - entry_tested: how many candidates are tested (8 bytes), complete.
+// - entry_erase: nothing, the sweep is gone.
+constexpr std::string_view checkpoint_magic = "MFSWEEP2";
+
+enum EntryKind : std::uint8_t {
+    entry_start,
+    entry_candidates,
+    entry_tested,
+    entry_erase,
+};
+
+void put(std::string& out, std::uint64_t value, std::size_t size) {
+    for (auto i = 0uz; i < size; i++) {
+        out += static_cast<char>(value >> (8 * i));
+    }
+}
+
+class CheckpointReader {
+public:
+    CheckpointReader(std::string_view data, const std::filesystem::path& path)
+    : m_data(data),
+      m_path(path) {}
+
+    bool empty() const { return m_data.empty(); }
+
+    std::size_t size() const { return m_data.size(); }
+
+    std::uint64_t get(std::size_t size) {
+        if (m_data.size() < size) invalid();
+        std::uint64_t ret{};
+        for (auto i = 0uz; i < size; i++) {
+            auto byte  = static_cast<std::uint8_t>(m_data[i]);
+            ret       |= static_cast<std::uint64_t>(byte) << (8 * i);
+        }
+        m_data.remove_prefix(size);
+        return ret;
+    }
+
+    // A count of size bytes, of items that must still fit into the file.
+    std::size_t count(std::size_t size, std::size_t item_size) {
+        auto ret = get(size);
+        if (ret > m_data.size() / item_size) invalid();
+        return ret;
+    }
+
+    CheckpointReader take(std::size_t size) {
+        if (m_data.size() < size) invalid();
+        auto ret = m_data.substr(0, size);
+        m_data.remove_prefix(size);
+        return {ret, m_path};
+    }
+
+    [[noreturn]] void invalid() const {
+        throw std::runtime_error(
+            std::format("{} is not a valid checkpoint.", m_path.string())
+        );
+    }
+
+private:
+    std::string_view             m_data;
+    const std::filesystem::path& m_path;
+};
+
+// Starts an entry of kind about the target, the caller appends the rest. Its
+// size is filled in when the writer goes out of scope.
+class EntryWriter {
+public:
+    EntryWriter(
+        std::string&                     out,
+        EntryKind                        kind,
+        const std::vector<std::uint8_t>& uid,
+        std::uint8_t                     block,
+        MifareKey                        key_type
+    )
+    : m_out(out),
+      m_begin(out.size()) {
+        put(m_out, 0, 4);
+        put(m_out, kind, 1);
+        put(m_out, uid.size(), 1);
+        for (auto byte : uid) {
+            put(m_out, byte, 1);
+        }
+        put(m_out, block, 1);
+        put(m_out, static_cast<std::uint8_t>(key_type), 1);
+    }
+
+    ~EntryWriter() {
+        auto size = m_out.size() - m_begin - 4;
+        for (auto i = 0uz; i < 4; i++) {
+            m_out[m_begin + i] = static_cast<char>(size >> (8 * i));
+        }
+    }
+
+private:
+    std::string& m_out;
+    std::size_t  m_begin;
+};
+
+void put_candidates(
+    std::string&                     out,
+    const std::vector<std::uint8_t>& uid,
+    std::uint8_t                     block,
+    MifareKey                        key_type,
+    std::span<const std::uint64_t>   candidates
+) {
+    if (candidates.empty()) return;
+    EntryWriter entry(out, entry_candidates, uid, block, key_type);
+    for (auto key : candidates) {
+        put(out, key, 6);
+    }
+}
+
+void put_tested(
+    std::string&                     out,
+    const std::vector<std::uint8_t>& uid,
+    std::uint8_t                     block,
+    MifareKey                        key_type,
+    const SweepProgress&             progress
+) {
+    EntryWriter entry(out, entry_tested, uid, block, key_type);
+    put(out, progress.tested, 8);
+    put(out, progress.complete, 1);
+}
+
+void put_sweep(
+    std::string&                     out,
+    const std::vector<std::uint8_t>& uid,
+    std::uint8_t                     block,
+    MifareKey                        key_type,
+    const SweepProgress&             progress
+) {
+    {
+        EntryWriter entry(out, entry_start, uid, block, key_type);
+        put(out, progress.complete, 1);
+        put(out, progress.nt_encs.size(), 1);
+        for (auto& [nonce, keystream, parity] : progress.nt_encs) {
+            put(out, nonce, 4);
+            put(out, keystream, 4);
+            put(out, parity.has_value(), 1);
+            put(out, parity.value_or(0), 1);
+        }
+    }
+    put_candidates(out, uid, block, key_type, progress.candidates);
+    put_tested(out, uid, block, key_type, progress);
+}
+
+} // namespace
+
+SweepCheckpoint::SweepCheckpoint(std::filesystem::path path)
+: m_path(std::move(path)) {
+    std::ifstream ifs(m_path, std::ios::binary);
+    if (ifs) {
+        std::string data{
+            std::istreambuf_iterator<char>(ifs),
+            std::istreambuf_iterator<char>()
+        };
+        ifs.close();
+        if (!data.starts_with(checkpoint_magic)) {
+            throw std::runtime_error(
+                std::format("{} is not a valid checkpoint.", m_path.string())
+            );
+        }
+
+        CheckpointReader reader(
+            std::string_view(data).substr(checkpoint_magic.size()),
+            m_path
+        );
+        // An entry torn by a crash in the middle of a write ends the file.
+        while (reader.size() >= 4) {
+            auto size = reader.get(4);
+            if (size > reader.size()) break;
+            auto entry = reader.take(size);
+
+            auto                      kind = entry.get(1);
+            std::vector<std::uint8_t> uid(entry.count(1, 1));
+            for (auto& byte : uid) {
+                byte = entry.get(1);
+            }
+            auto   block    = static_cast<std::uint8_t>(entry.get(1));
+            auto   key_type = static_cast<MifareKey>(entry.get(1));
+            Target target{std::move(uid), block, key_type};
+
+            if (kind == entry_start) {
+                SweepProgress progress;
+                progress.complete = entry.get(1);
+                progress.nt_encs.resize(entry.count(1, 10));
+                for (auto& [nonce, keystream, parity] : progress.nt_encs) {
+                    nonce           = entry.get(4);
+                    keystream       = entry.get(4);
+                    auto has_parity = entry.get(1);
+                    auto bits       = entry.get(1);
+                    if (has_parity) parity = bits;
+                }
+                m_sweeps[std::move(target)] = std::move(progress);
+                continue;
+            }
+            if (kind == entry_erase) {
+                m_sweeps.erase(target);
+                continue;
+            }
+            auto it = m_sweeps.find(target);
+            if (it == m_sweeps.end()) entry.invalid();
+            if (kind == entry_candidates) {
+                if (entry.size() % 6) entry.invalid();
+                while (!entry.empty()) {
+                    it->second.candidates.push_back(entry.get(6));
+                }
+            } else if (kind == entry_tested) {
+                it->second.tested   = entry.get(8);
+                it->second.complete = entry.get(1);
+            } else {
+                entry.invalid();
+            }
+        }
+    }
+
+    // Compacted into one start of every sweep, written aside first so that
+    // an interrupted rewrite keeps the previous file.
+    std::string data(checkpoint_magic);
+    for (auto& [target, progress] : m_sweeps) {
+        auto& [uid, block, key_type] = target;
+        put_sweep(data, uid, block, key_type, progress);
+    }
+    auto temp = m_path;
+    temp += ".tmp";
+    {
+        std::ofstream ofs(temp, std::ios::binary);
+        if (!ofs.write(data.data(), data.size())) {
+            throw std::runtime_error("Can't write file.");
+        }
+    }
+    std::filesystem::rename(temp, m_path);
+
+    m_ofs.open(m_path, std::ios::binary | std::ios::app);
+    if (!m_ofs) {
+        throw std::runtime_error("Can't open file.");
+    }
+}
+
+std::optional<SweepProgress> SweepCheckpoint::find(
+    const ISO14443ACard& card,
+    std::uint8_t         block,
+    MifareKey            key_type
+) const {
+    std::scoped_lock lock(m_mutex);
+
+    auto it = m_sweeps.find({card.uid, block, key_type});
+    if (it == m_sweeps.end()) return std::nullopt;
+    return it->second;
+}
+
+void SweepCheckpoint::update(
+    const ISO14443ACard& card,
+    std::uint8_t         block,
+    MifareKey            key_type,
+    SweepProgress        progress
+) {
+    std::scoped_lock lock(m_mutex);
+
+    std::string entries;
+    put_sweep(entries, card.uid, block, key_type, progress);
+    append(entries);
+    m_sweeps[{card.uid, block, key_type}] = std::move(progress);
+}
+
+void SweepCheckpoint::extend(
+    const ISO14443ACard&           card,
+    std::uint8_t                   block,
+    MifareKey                      key_type,
+    std::span<const std::uint64_t> candidates,
+    std::size_t                    tested,
+    bool                           complete
+) {
+    std::scoped_lock lock(m_mutex);
+
+    auto& progress = m_sweeps.at({card.uid, block, key_type});
+    if (candidates.empty() && progress.tested == tested
+        && progress.complete == complete) {
+        return;
+    }
+    progress.candidates.append_range(candidates);
+    progress.tested   = tested;
+    progress.complete = complete;
+
+    std::string entries;
+    put_candidates(entries, card.uid, block, key_type, candidates);
+    put_tested(entries, card.uid, block, key_type, progress);
+    append(entries);
+}
+
+void SweepCheckpoint::erase(
+    const ISO14443ACard& card,
+    std::uint8_t         block,
+    MifareKey            key_type
+) {
+    std::scoped_lock lock(m_mutex);
+
+    if (!m_sweeps.erase({card.uid, block, key_type})) return;
+    std::string entry;
+    { EntryWriter writer(entry, entry_erase, card.uid, block, key_type); }
+    append(entry);
+}
+
+void SweepCheckpoint::append(const std::string& entries) {
+    m_ofs.write(entries.data(), entries.size());
+    if (!m_ofs.flush()) {
+        throw std::runtime_error("Can't write file.");
+    }
+}
+
+} // namespace nfcpp::static_nested
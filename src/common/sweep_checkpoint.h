@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <tuple>
+
+#include "types.h"
+
+namespace nfcpp::static_nested {
+
+// Where the candidate sweep of one target got to.
+struct SweepProgress {
+    std::vector<EncryptedNonce> nt_encs;
+    // In the order they are tested, the first `tested` ones are wrong.
+    std::vector<std::uint64_t> candidates;
+    std::size_t                tested{};
+    // Otherwise the recovery was cut short and candidates is only a part.
+    bool complete{};
+};
+
+// The sweeps of unfinished targets, per UID, block and key type. Kept in a
+// file so that an interrupted run can be resumed, every change is appended
+// (and flushed) to it and the file is compacted when it is opened. Safe to use
+// from several threads.
+class SweepCheckpoint {
+public:
+    // Starts empty if the file does not exist yet.
+    explicit SweepCheckpoint(std::filesystem::path path);
+
+    std::optional<SweepProgress> find(
+        const ISO14443ACard& card,
+        std::uint8_t         block,
+        mifare::MifareKey    key_type
+    ) const;
+
+    // Starts the sweep of the target over from progress.
+    void update(
+        const ISO14443ACard& card,
+        std::uint8_t         block,
+        mifare::MifareKey    key_type,
+        SweepProgress        progress
+    );
+
+    // Appends the candidates found since and records how far the sweep got,
+    // without writing the earlier candidates again.
+    void extend(
+        const ISO14443ACard&           card,
+        std::uint8_t                   block,
+        mifare::MifareKey              key_type,
+        std::span<const std::uint64_t> candidates,
+        std::size_t                    tested,
+        bool                           complete
+    );
+
+    void erase(
+        const ISO14443ACard& card,
+        std::uint8_t         block,
+        mifare::MifareKey    key_type
+    );
+
+private:
+    using Target = std::
+        tuple<std::vector<std::uint8_t>, std::uint8_t, mifare::MifareKey>;
+
+    void append(const std::string& entries);
+
+    std::filesystem::path           m_path;
+    std::ofstream                   m_ofs;
+    mutable std::mutex              m_mutex;
+    std::map<Target, SweepProgress> m_sweeps;
+};
+
+} // namespace nfcpp::static_nested
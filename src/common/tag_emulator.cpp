@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include "common/tag_emulator.h"
+
+#include "utility.h"
+
+namespace nfcpp::mifare {
+
+namespace {
+
+using namespace util;
+
+constexpr std::uint8_t nack = 0x04;
+
+constexpr std::uint64_t default_key = 0xFFFFFFFFFFFF;
+
+std::size_t block_count(MifareCard type) {
+    switch (type) {
+    case MifareCard::ClassicMini:
+        return 20;
+    case MifareCard::Classic1K:
+        return 64;
+    case MifareCard::Classic2K:
+        return 128;
+    case MifareCard::Classic4K:
+        return 256;
+    default:
+        throw std::invalid_argument("Unsupported card type.");
+    }
+}
+
+bool is_trailer(std::uint8_t block) {
+    return block < 128 ? block % 4 == 3 : block % 16 == 15;
+}
+
+RawFrame short_answer(std::uint8_t value) {
+    RawFrame ret;
+    ret.bytes[0] = value;
+    ret.bits     = 4;
+    return ret;
+}
+
+} // namespace
+
+SimulatedTag::SimulatedTag(SimulatedTagConfig config)
+: m_config(std::move(config)),
+  m_blocks(block_count(m_config.type)) {
+    auto uid_size = m_config.uid.size();
+    if (uid_size != 4 && uid_size != 7 && uid_size != 10) {
+        throw std::invalid_argument("UID must be 4, 7 or 10 bytes long.");
+    }
+
+    std::memcpy(&m_nuid, m_config.uid.data(), sizeof(m_nuid));
+    m_nuid = to_big_endian(m_nuid);
+
+    // Manufacturer block
+    auto& block0 = m_blocks[0];
+    std::ranges::copy(m_config.uid, block0.begin());
+    if (uid_size == 4) {
+        block0[4] = bcc(cascade_uid(0));
+        block0[5] = m_config.sak;
+        block0[6] = m_config.atqa[0];
+        block0[7] = m_config.atqa[1];
+    }
+
+    for (auto start_block : start_block_sequence(m_config.type)) {
+        auto  sector  = block_to_sector(start_block);
+        auto& trailer = m_blocks[start_block + (start_block < 128 ? 3 : 15)];
+        auto  key_a   = default_key;
+        auto  key_b   = default_key;
+        for (auto& key : m_config.keys) {
+            if (key.sector != sector) continue;
+            if (key.key_a) key_a = *key.key_a;
+            if (key.key_b) key_b = *key.key_b;
+        }
+        put_key(std::span(trailer).first<6>(), key_a);
+        trailer[6] = 0xFF;
+        trailer[7] = 0x07;
+        trailer[8] = 0x80;
+        trailer[9] = 0x69;
+        put_key(std::span(trailer).last<6>(), key_b);
+    }
+}
+
+RawFrame SimulatedTag::transceive(const RawFrame& frame) {
+    if (m_config.latency.count()) {
+        std::this_thread::sleep_for(m_config.latency);
+    }
+    auto answer = handle(frame);
+    if (!answer) {
+        if (m_config.timeout.count()) {
+            std::this_thread::sleep_for(m_config.timeout);
+        }
+        throw_nfc_error(NfcError::RFTRANS);
+    }
+    return *answer;
+}
+
+std::optional<RawFrame> SimulatedTag::handle(const RawFrame& frame) {
+    if (frame.bits == 7) {
+        auto cmd  = frame.bytes[0];
+        auto wake = (m_state == State::Idle && (cmd == 0x26 || cmd == 0x52))
+                 || (m_state == State::Halt && cmd == 0x52);
+        if (!wake) return reset();
+        m_halted        = m_state == State::Halt;
+        m_state         = State::Ready;
+        m_cascade_level = 0;
+        return make_frame(m_config.atqa, false);
+    }
+
+    switch (m_state) {
+    case State::Idle:
+    case State::Halt:
+        return std::nullopt;
+    case State::Ready:
+        return handle_select(frame);
+    case State::Active: {
+        if (!check_crc(frame) || frame.size() != 4) return reset();
+        auto cmd = frame.bytes[0];
+        if (cmd == 0x60 || cmd == 0x61) {
+            return start_auth(cmd, frame.bytes[1], false);
+        }
+        if (cmd == 0x50 && frame.bytes[1] == 0x00) {
+            m_state = State::Halt;
+            return std::nullopt;
+        }
+        return reset();
+    }
+    case State::AuthReply:
+        return handle_auth_reply(frame);
+    case State::Authenticated:
+        return handle_encrypted(frame);
+    }
+    return std::nullopt;
+}
+
+std::optional<RawFrame> SimulatedTag::handle_select(const RawFrame& frame) {
+    const std::uint8_t cascade_level = 0x93 + 2 * m_cascade_level;
+
+    if (frame.bits < 16 || frame.bytes[0] != cascade_level) return reset();
+
+    auto         uid = cascade_uid(m_cascade_level);
+    std::uint8_t bcc = util::bcc(uid);
+
+    // ANTICOLLISION, there is only one tag so no collision ever happens.
+    if (frame.bits == 16 && frame.bytes[1] == 0x20) {
+        return make_frame({uid[0], uid[1], uid[2], uid[3], bcc}, false);
+    }
+
+    // SELECT
+    if (frame.size() != 9 || frame.bytes[1] != 0x70 || !check_crc(frame)
+        || !std::ranges::equal(frame.data().subspan(2, 4), uid)
+        || frame.bytes[6] != bcc) {
+        return reset();
+    }
+    if (++m_cascade_level < cascade_levels()) {
+        return make_frame({0x04}, true);
+    }
+    m_state = State::Active;
+    return make_frame({m_config.sak}, true);
+}
+
+std::optional<RawFrame>
+SimulatedTag::handle_auth_reply(const RawFrame& frame) {
+    if (frame.bits != 64) return reset();
+
+    std::uint32_t nr_enc = get_u32(frame);
+    std::uint32_t ar_enc = 0;
+    for (auto i = 4uz; i < 8; i++) {
+        ar_enc = ar_enc << 8 | frame.bytes[i];
+    }
+
+    m_cipher.word(nr_enc, true);
+    if ((ar_enc ^ m_cipher.word(0, false)) != prng_successor(m_nt, 64)) {
+        return reset();
+    }
+
+    std::array<std::uint8_t, 4> at;
+    put_u32(at, prng_successor(m_nt, 96));
+
+    auto ret = make_frame(at, false);
+    encrypt_frame(ret, m_cipher);
+    m_state = State::Authenticated;
+    return ret;
+}
+
+std::optional<RawFrame> SimulatedTag::handle_encrypted(RawFrame frame) {
+    decrypt_frame(frame, m_cipher);
+    if (!check_crc(frame) || frame.size() != 4) return reset();
+
+    auto cmd   = frame.bytes[0];
+    auto block = frame.bytes[1];
+    switch (cmd) {
+    case 0x30: {
+        if (block >= m_blocks.size()
+            || block_to_sector(block) != m_auth_sector) {
+            auto ret = short_answer(nack);
+            encrypt_frame(ret, m_cipher);
+            reset();
+            return ret;
+        }
+        auto data = m_blocks[block];
+        // KeyA is never readable.
+        if (is_trailer(block)) std::ranges::fill_n(data.begin(), 6, 0);
+        auto ret = make_frame(data, true);
+        encrypt_frame(ret, m_cipher);
+        return ret;
+    }
+    case 0x60:
+    case 0x61:
+        return start_auth(cmd, block, true);
+    case 0x50:
+        m_state = State::Halt;
+        return std::nullopt;
+    default:
+        return reset();
+    }
+}
+
+std::optional<RawFrame>
+SimulatedTag::start_auth(std::uint8_t cmd, std::uint8_t block, bool nested) {
+    if (block >= m_blocks.size()) {
+        auto ret = short_answer(nack);
+        if (nested) encrypt_frame(ret, m_cipher);
+        reset();
+        return ret;
+    }
+
+    auto nt = next_nonce(nested);
+
+    m_cipher      = Crypto1State::from_key(key_of(block, cmd));
+    m_nt          = nt;
+    m_auth_sector = block_to_sector(block);
+    m_state       = State::AuthReply;
+
+    std::array<std::uint8_t, 4> nt_bytes;
+    put_u32(nt_bytes, nt);
+
+    if (!nested) {
+        m_cipher.word(m_nuid ^ nt, false);
+        return make_frame(nt_bytes, false);
+    }
+
+    // The nonce is clocked into the LFSR while it is being encrypted.
+    std::array<std::uint8_t, 4> feed;
+    put_u32(feed, m_nuid ^ nt);
+
+    RawFrame ret;
+    for (auto i = 0uz; i < 4; i++) {
+        ret.bytes[i]  = nt_bytes[i] ^ m_cipher.byte(feed[i], false);
+        ret.parity[i] = odd_parity8(nt_bytes[i]) ^ m_cipher.peek();
+    }
+    ret.bits = 32;
+    return ret;
+}
+
+std::uint32_t SimulatedTag::next_nonce(bool nested) {
+    m_nested_count = nested ? m_nested_count + 1 : 0;
+    if (m_config.static_nonce) {
+        return prng_successor(
+            *m_config.static_nonce,
+            nested ? m_nested_count * m_config.nested_distance + 1 : 0
+        );
+    }
+    m_prng = prng_successor(m_prng, m_config.nested_distance);
+    return m_prng;
+}
+
+std::uint64_t
+SimulatedTag::key_of(std::uint8_t block, std::uint8_t cmd) const {
+    auto trailer = std::span(m_blocks[block < 128 ? block | 3 : block | 15]);
+    return get_key(cmd == 0x60 ? trailer.first<6>() : trailer.last<6>());
+}
+
+std::array<std::uint8_t, 4>
+SimulatedTag::cascade_uid(std::size_t level) const {
+    auto& uid = m_config.uid;
+    if (level + 1 == cascade_levels()) {
+        std::array<std::uint8_t, 4> ret;
+        std::ranges::copy(std::span(uid).last<4>(), ret.begin());
+        return ret;
+    }
+    auto offset = level * 3;
+    return {0x88, uid[offset], uid[offset + 1], uid[offset + 2]};
+}
+
+std::size_t SimulatedTag::cascade_levels() const {
+    return (m_config.uid.size() - 1) / 3;
+}
+
+std::optional<RawFrame> SimulatedTag::reset() {
+    m_state = m_halted ? State::Halt : State::Idle;
+    return std::nullopt;
+}
+
+} // namespace nfcpp::mifare
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <chrono>
+
+#include "common/transport.h"
+
+#include "types.h"
+
+namespace nfcpp::mifare {
+
+struct SimulatedTagConfig {
+    std::vector<std::uint8_t>   uid  = {0xDE, 0xAD, 0xBE, 0xEF};
+    std::array<std::uint8_t, 2> atqa = {0x04, 0x00};
+    std::uint8_t                sak  = 0x08;
+    MifareCard                  type = MifareCard::Classic1K;
+    // Sectors that are not listed use FFFFFFFFFFFF for both keys.
+    std::vector<SectorKey> keys;
+    // Nonce of the first auth in a session, std::nullopt makes the PRNG run
+    // freely like on an ordinary tag. The n-th nested auth of a session
+    // answers prng_successor(static_nonce, n * nested_distance + 1), which
+    // with the defaults below matches the 0x009080A2 tags.
+    std::optional<std::uint32_t> static_nonce    = 0x009080A2;
+    std::uint32_t                nested_distance = 160;
+    // Added to every frame, and to every frame that gets no answer.
+    std::chrono::microseconds latency{};
+    std::chrono::microseconds timeout{};
+};
+
+// An in-process Mifare Classic tag, frames are answered the way a real tag
+// would answer them (Crypto1 and parity bits included).
+class SimulatedTag : public Transport {
+public:
+    explicit SimulatedTag(SimulatedTagConfig config);
+
+    RawFrame transceive(const RawFrame& frame) override;
+
+private:
+    enum class State {
+        Idle,
+        Halt,
+        Ready,
+        Active,
+        AuthReply,
+        Authenticated,
+    };
+
+    std::optional<RawFrame> handle(const RawFrame& frame);
+
+    std::optional<RawFrame> handle_select(const RawFrame& frame);
+
+    std::optional<RawFrame> handle_encrypted(RawFrame frame);
+
+    std::optional<RawFrame> handle_auth_reply(const RawFrame& frame);
+
+    std::optional<RawFrame>
+    start_auth(std::uint8_t cmd, std::uint8_t block, bool nested);
+
+    std::uint32_t next_nonce(bool nested);
+
+    std::uint64_t key_of(std::uint8_t block, std::uint8_t cmd) const;
+
+    std::array<std::uint8_t, 4> cascade_uid(std::size_t level) const;
+
+    std::size_t cascade_levels() const;
+
+    std::optional<RawFrame> reset();
+
+private:
+    SimulatedTagConfig                        m_config;
+    std::vector<std::array<std::uint8_t, 16>> m_blocks;
+    std::uint32_t                             m_nuid;
+
+    // Context
+    State         m_state = State::Idle;
+    bool          m_halted{};
+    std::size_t   m_cascade_level{};
+    Crypto1State  m_cipher{};
+    std::uint32_t m_nt{};
+    std::uint8_t  m_auth_sector{};
+    std::size_t   m_nested_count{};
+    std::uint32_t m_prng = 0x01200145;
+};
+
+} // namespace nfcpp::mifare
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include "common/transport.h"
+
+namespace nfcpp::mifare {
+
+void throw_nfc_error(NfcError error) { throw NfcException(error); }
+
+RawFrame NfcTransport::transceive(const RawFrame& frame) {
+    RawFrame ret;
+
+    auto res = nfc_initiator_transceive_bits(
+        m_device,
+        frame.bytes.data(),
+        frame.bits,
+        frame.parity.data(),
+        ret.bytes.data(),
+        ret.bytes.size(),
+        ret.parity.data()
+    );
+    if (res < 0) {
+        throw_nfc_error(static_cast<NfcError>(res));
+    }
+    ret.bits = res;
+
+    return ret;
+}
+
+RawFrame transceive(
+    Transport&      transport,
+    FrameStats*     stats,
+    FrameOp         op,
+    const RawFrame& frame
+) {
+    if (!stats) return transport.transceive(frame);
+
+    auto start   = std::chrono::steady_clock::now();
+    auto elapsed = [&] { return std::chrono::steady_clock::now() - start; };
+    try {
+        auto ret = transport.transceive(frame);
+        stats->record(
+            op,
+            ret.bits == 4 ? FrameOutcome::nack : FrameOutcome::ok,
+            elapsed()
+        );
+        return ret;
+    } catch (const NfcException& e) {
+        auto outcome = FrameOutcome::error;
+        if (e.error_code() == NfcError::RFTRANS) {
+            outcome = FrameOutcome::timeout;
+        } else if (e.error_code() == NfcError::INVARG) {
+            outcome = FrameOutcome::nack;
+        }
+        stats->record(op, outcome, elapsed());
+        throw;
+    }
+}
+
+} // namespace nfcpp::mifare
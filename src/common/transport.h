@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <nfcpp/nfc.hpp>
+
+#include "common/frame_stats.h"
+#include "common/iso14443a_frame.h"
+
+namespace nfcpp::mifare {
+
+// Throws the same NfcException a real device would report, so callers only
+// have to handle one kind of error whatever the transport is.
+[[noreturn]] void throw_nfc_error(NfcError error);
+
+// Where MifareClassicInitiator sends its raw frames to.
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    // Returns the answer of the tag, throws NfcError::RFTRANS if there is none.
+    virtual RawFrame transceive(const RawFrame& frame) = 0;
+};
+
+// A libnfc device, which must already be in raw mode (no easy framing, no CRC
+// and no parity handling).
+class NfcTransport : public Transport {
+public:
+    explicit NfcTransport(nfc_device* device) : m_device(device) {}
+
+    RawFrame transceive(const RawFrame& frame) override;
+
+private:
+    nfc_device* m_device;
+};
+
+// transport.transceive(), also timed into stats unless it is nullptr.
+RawFrame transceive(
+    Transport&      transport,
+    FrameStats*     stats,
+    FrameOp         op,
+    const RawFrame& frame
+);
+
+} // namespace nfcpp::mifare
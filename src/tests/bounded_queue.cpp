@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "tests/test.h"
+
+#include "bounded_queue.h"
+
+using namespace nfcpp::util;
+
+TEST_CASE(bounded_queue_drains_after_close) {
+    BoundedQueue<int> queue(4);
+    CHECK(queue.push(1));
+    CHECK(queue.push(2));
+    CHECK(queue.push(3));
+    queue.close();
+
+    // Closing keeps what is queued, in order, but takes nothing new.
+    CHECK(!queue.push(4));
+    CHECK(queue.pop() == 1);
+    CHECK(queue.pop() == 2);
+    CHECK(queue.pop() == 3);
+    CHECK(!queue.pop());
+}
+
+TEST_CASE(bounded_queue_close_wakes_consumer) {
+    BoundedQueue<int>  queue(4);
+    std::optional<int> popped = 0;
+    {
+        std::jthread consumer([&] { popped = queue.pop(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        queue.close();
+    }
+    CHECK(!popped);
+}
+
+TEST_CASE(bounded_queue_close_wakes_producer) {
+    BoundedQueue<int> queue(2);
+    CHECK(queue.try_push(1));
+    CHECK(queue.try_push(2));
+    CHECK(!queue.try_push(3));
+
+    auto pushed = true;
+    {
+        std::jthread producer([&] { pushed = queue.push(3); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        queue.close();
+    }
+    CHECK(!pushed);
+    // What was queued is still there after the close.
+    CHECK(queue.pop() == 1);
+    CHECK(queue.pop() == 2);
+    CHECK(!queue.pop());
+}
+
+TEST_CASE(bounded_queue_many_producers_and_consumers) {
+    constexpr auto per_producer = 10000uz;
+    constexpr auto producers    = 4uz;
+    constexpr auto consumers    = 4uz;
+
+    BoundedQueue<std::size_t> queue(64);
+    std::atomic<std::size_t>  sum{};
+    std::atomic<std::size_t>  count{};
+    {
+        std::vector<std::jthread> threads;
+        for (auto i = 0uz; i < consumers; i++) {
+            threads.emplace_back([&] {
+                while (auto value = queue.pop()) {
+                    sum += *value;
+                    count++;
+                }
+            });
+        }
+        {
+            std::vector<std::jthread> pushers;
+            for (auto i = 0uz; i < producers; i++) {
+                pushers.emplace_back([&, i] {
+                    for (auto j = 0uz; j < per_producer; j++) {
+                        queue.push(i * per_producer + j);
+                    }
+                });
+            }
+        }
+        queue.close();
+    }
+
+    auto total = producers * per_producer;
+    CHECK(count == total);
+    CHECK(sum == total * (total - 1) / 2);
+}
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include <fstream>
+
+#include "tests/test.h"
+
+#include "common/candidate_cache.h"
+
+using namespace nfcpp;
+using namespace nfcpp::static_nested;
+
+namespace {
+
+constexpr std::array<EncryptedNonce, 2> nt_encs{{
+    {0x01200145, 0x8DA7B3C1, {}},
+    {0x2B2A4EF1, 0x0F7E66A2, {}},
+}};
+
+constexpr std::uint32_t nuid = 0x01020304;
+
+} // namespace
+
+TEST_CASE(candidate_cache_round_trip) {
+    test::TempPath path("nfcpp-test-candidates");
+
+    // Deltas of one LEB128 byte up to the full 48 bits, and a zero delta.
+    std::vector<std::uint64_t> states{
+        0,
+        0x7F,
+        0x80,
+        0x3FFF,
+        0x4000,
+        0x4000,
+        0x123456789A,
+        0xFFFFFFFFFFFE,
+        0xFFFFFFFFFFFF,
+    };
+    {
+        CandidateCache cache(path.get());
+        CHECK(!cache.find(nt_encs, nuid));
+        cache.add(nt_encs, nuid, states);
+    }
+
+    CandidateCache cache(path.get());
+    CHECK(cache.find(nt_encs, nuid) == states);
+    CHECK(!cache.find(nt_encs, nuid + 1));
+}
+
+TEST_CASE(candidate_cache_ignores_broken_file) {
+    test::TempPath path("nfcpp-test-candidates");
+    CandidateCache cache(path.get());
+    cache.add(nt_encs, nuid, std::vector<std::uint64_t>{1, 0x100000, 0x200000});
+
+    // Cut off within the last delta.
+    auto file = std::filesystem::directory_iterator(path.get())->path();
+    std::filesystem::resize_file(file, std::filesystem::file_size(file) - 1);
+    CHECK(!cache.find(nt_encs, nuid));
+}
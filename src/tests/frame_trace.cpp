@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include "tests/test.h"
+
+#include "common/frame_trace.h"
+#include "common/static_nested.h"
+#include "common/tag_emulator.h"
+
+using namespace nfcpp;
+using namespace nfcpp::mifare;
+using namespace nfcpp::static_nested;
+
+namespace {
+
+constexpr std::uint64_t default_key = 0xFFFFFFFFFFFF;
+constexpr std::uint64_t target_key  = 0x123456789ABC;
+
+const NonceCalibration calibration{{161, 321, 481}, 1.0, 1};
+
+StaticNestedResult attack(Transport& transport) {
+    MifareClassicInitiator initiator(transport);
+
+    auto card = initiator.select_card();
+    CHECK(card);
+
+    // All threads, the keys must still go on air in the recorded order.
+    return execute(
+        initiator,
+        *card,
+        0,
+        MifareKey::A,
+        default_key,
+        4,
+        MifareKey::B,
+        calibration,
+        {.threads = 0}
+    );
+}
+
+} // namespace
+
+TEST_CASE(trace_replays_a_recorded_attack) {
+    test::TempPath path("nfcpp-test-attack.trace");
+
+    SimulatedTag       tag({.keys = {{1, default_key, target_key}}});
+    StaticNestedResult recorded;
+    {
+        TraceRecorder recorder(tag, path.get());
+        recorded = attack(recorder);
+    }
+    CHECK(recorded.success);
+
+    for (auto i = 0; i < 3; i++) {
+        ReplayTransport replay(path.get());
+        auto            replayed = attack(replay);
+        CHECK(replayed.success);
+        CHECK(replayed.key == target_key);
+        CHECK(replayed.tested_key_count == recorded.tested_key_count);
+    }
+}
+
+TEST_CASE(trace_rejects_another_run) {
+    test::TempPath path("nfcpp-test-attack.trace");
+
+    SimulatedTag tag({.keys = {{1, default_key, target_key}}});
+    {
+        TraceRecorder          recorder(tag, path.get());
+        MifareClassicInitiator initiator(recorder);
+        CHECK(initiator.select_card());
+    }
+
+    // Not the HLTA that select_card() sent first.
+    ReplayTransport replay(path.get());
+    auto            thrown = false;
+    try {
+        replay.transceive(frames::reqa);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
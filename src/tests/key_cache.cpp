@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include <fstream>
+
+#include "tests/test.h"
+
+#include "common/key_cache.h"
+
+using namespace nfcpp;
+using namespace nfcpp::mifare;
+
+namespace {
+
+const ISO14443ACard card{
+    .atqa = {0x04, 0x00},
+    .uid  = {0x01, 0x02, 0x03, 0x04},
+    .nuid = 0x01020304,
+    .sak  = 0x08,
+};
+
+// Magic, then records of 18 bytes for a 4 byte UID, the key 10 bytes in.
+constexpr std::size_t record_size = 18;
+
+std::size_t record_offset(std::size_t index) {
+    return KeyCache::cache_magic.size() + index * record_size;
+}
+
+} // namespace
+
+TEST_CASE(key_cache_round_trip) {
+    test::TempPath path("nfcpp-test-keys.db");
+    {
+        KeyCache cache(path.get());
+        cache.add(card, 1, MifareKey::A, 0xA0A1A2A3A4A5);
+        cache.add(card, 1, MifareKey::B, 0xB0B1B2B3B4B5);
+        cache.add(card, 2, MifareKey::A, 0xFFFFFFFFFFFF);
+        cache.add(card, 2, MifareKey::A, 0xD3F7D3F7D3F7);
+    }
+
+    KeyCache cache(path.get());
+    auto     keys = cache.find(card);
+    CHECK(keys.size() == 2);
+    CHECK(keys[0].sector == 1);
+    CHECK(keys[0].key_a == 0xA0A1A2A3A4A5);
+    CHECK(keys[0].key_b == 0xB0B1B2B3B4B5);
+    CHECK(keys[1].sector == 2);
+    CHECK(keys[1].key_a == 0xD3F7D3F7D3F7);
+    CHECK(!keys[1].key_b);
+}
+
+TEST_CASE(key_cache_cuts_off_torn_tail) {
+    test::TempPath path("nfcpp-test-keys.db");
+    {
+        KeyCache cache(path.get());
+        cache.add(card, 1, MifareKey::A, 0xA0A1A2A3A4A5);
+    }
+    {
+        std::ofstream ofs(path.get(), std::ios::binary | std::ios::app);
+        ofs.write("\x04\x01\x02\x03\x04\x04", 6);
+    }
+    {
+        KeyCache cache(path.get());
+        CHECK(std::filesystem::file_size(path.get()) == record_offset(1));
+        cache.add(card, 2, MifareKey::B, 0xB0B1B2B3B4B5);
+    }
+
+    // The record added after the cut is read back as well.
+    KeyCache cache(path.get());
+    auto     keys = cache.find(card);
+    CHECK(keys.size() == 2);
+    CHECK(keys[0].key_a == 0xA0A1A2A3A4A5);
+    CHECK(keys[1].key_b == 0xB0B1B2B3B4B5);
+}
+
+TEST_CASE(key_cache_skips_corrupt_record) {
+    test::TempPath path("nfcpp-test-keys.db");
+    {
+        KeyCache cache(path.get());
+        cache.add(card, 1, MifareKey::A, 0xA0A1A2A3A4A5);
+        cache.add(card, 2, MifareKey::A, 0xB0B1B2B3B4B5);
+        cache.add(card, 3, MifareKey::A, 0xC0C1C2C3C4C5);
+    }
+    {
+        std::fstream fs(
+            path.get(),
+            std::ios::binary | std::ios::in | std::ios::out
+        );
+        fs.seekp(record_offset(1) + 10);
+        fs.put('\x00');
+    }
+
+    KeyCache cache(path.get());
+    auto     keys = cache.find(card);
+    CHECK(keys.size() == 2);
+    CHECK(keys[0].sector == 1);
+    CHECK(keys[1].sector == 3);
+    CHECK(keys[1].key_a == 0xC0C1C2C3C4C5);
+    CHECK(std::filesystem::file_size(path.get()) == record_offset(3));
+}
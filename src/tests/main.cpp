@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include <algorithm>
+#include <print>
+#include <string_view>
+
+#include "tests/test.h"
+
+using namespace nfcpp::test;
+
+// Runs every test, or only the ones named on the command line.
+int main(int argc, char* argv[]) {
+    std::vector<std::string_view> selected(argv + 1, argv + argc);
+
+    auto failed = 0uz;
+    auto ran    = 0uz;
+    for (auto& [name, fn] : test_cases()) {
+        if (!selected.empty() && !std::ranges::contains(selected, name)) {
+            continue;
+        }
+        ran++;
+        try {
+            fn();
+            std::println("PASS {}", name);
+        } catch (const std::exception& e) {
+            failed++;
+            std::println("FAIL {}: {}", name, e.what());
+        }
+    }
+
+    std::println("{} of {} tests passed.", ran - failed, ran);
+    return failed ? 1 : 0;
+}
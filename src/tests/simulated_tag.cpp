@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include <ranges>
+
+#include "tests/test.h"
+
+#include "common/mifare_initiator.h"
+#include "common/tag_emulator.h"
+
+using namespace nfcpp;
+using namespace nfcpp::mifare;
+
+namespace {
+
+constexpr std::uint64_t default_key = 0xFFFFFFFFFFFF;
+
+// The plain nonces of an auth and of two nested auths after it.
+std::array<std::uint32_t, 3>
+auth_chain(MifareClassicInitiator& initiator, const ISO14443ACard& card) {
+    Crypto1State                 cipher{};
+    std::array<std::uint32_t, 3> ret;
+    CHECK(initiator.select_card(card.uid));
+    for (auto i : std::views::iota(0uz, ret.size())) {
+        CHECK(initiator.auth(
+            cipher,
+            MifareKey::A,
+            card,
+            0,
+            default_key,
+            i != 0,
+            ret[i]
+        ));
+    }
+    return ret;
+}
+
+} // namespace
+
+TEST_CASE(simulated_tag_static_nonce_sequence) {
+    SimulatedTag           tag({});
+    MifareClassicInitiator initiator(tag);
+
+    auto card = initiator.select_card();
+    CHECK(card);
+
+    auto nt = auth_chain(initiator, *card);
+    CHECK(nt[0] == 0x009080A2);
+    CHECK(nt[1] == prng_successor(nt[0], 161));
+    CHECK(nt[2] == prng_successor(nt[0], 321));
+    // Every session starts over from the same nonce.
+    CHECK(auth_chain(initiator, *card) == nt);
+}
+
+TEST_CASE(simulated_tag_free_running_prng) {
+    SimulatedTag           tag({.static_nonce = std::nullopt});
+    MifareClassicInitiator initiator(tag);
+
+    auto card = initiator.select_card();
+    CHECK(card);
+
+    auto first  = auth_chain(initiator, *card);
+    auto second = auth_chain(initiator, *card);
+    CHECK(first[1] == prng_successor(first[0], 160));
+    CHECK(first[2] == prng_successor(first[1], 160));
+    CHECK(second[0] == prng_successor(first[2], 160));
+}
+
+TEST_CASE(simulated_tag_keys_from_the_trailer) {
+    SimulatedTag tag({.keys = {{1, 0xA0A1A2A3A4A5, 0x123456789ABC}}});
+    MifareClassicInitiator initiator(tag);
+    Crypto1State           cipher{};
+
+    auto card = initiator.select_card();
+    CHECK(card);
+
+    CHECK(initiator.test_key(cipher, MifareKey::A, *card, 4, 0xA0A1A2A3A4A5));
+    CHECK(initiator.test_key(cipher, MifareKey::B, *card, 4, 0x123456789ABC));
+    // Byte swapped, as a little endian read of the trailer would give it.
+    CHECK(!initiator.test_key(cipher, MifareKey::B, *card, 4, 0xBC9A78563412));
+    CHECK(initiator.test_key(cipher, MifareKey::A, *card, 0, default_key));
+}
@@ -0,0 +1,273 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <ranges>
+
+#include "tests/test.h"
+
+#include "common/crypto1.h"
+#include "common/static_nested.h"
+#include "common/static_nested_solver.h"
+#include "common/tag_emulator.h"
+
+using namespace nfcpp;
+using namespace nfcpp::mifare;
+using namespace nfcpp::static_nested;
+
+namespace {
+
+constexpr std::uint64_t default_key = 0xFFFFFFFFFFFF;
+constexpr std::uint64_t target_key  = 0x123456789ABC;
+
+// The distances of the default SimulatedTag.
+const NonceCalibration calibration{{161, 321, 481}, 1.0, 1};
+
+// Counts the key tests ({nR}{aR}) of all readers, and when the key was found.
+struct KeyTests {
+    std::atomic<std::size_t> sent{};
+    std::atomic<std::size_t> found_at{};
+};
+
+// A reader in front of a tag, which fails like an unplugged one once told to,
+// or right when it would have found the key.
+class ReaderProbe : public Transport {
+public:
+    ReaderProbe(Transport& tag, KeyTests& tests, bool fail_on_key = false)
+    : m_tag(tag),
+      m_tests(tests),
+      m_fail_on_key(fail_on_key) {}
+
+    void unplug() { m_unplugged = true; }
+
+    RawFrame transceive(const RawFrame& frame) override {
+        if (m_unplugged) throw std::runtime_error("Reader unplugged.");
+        auto key_test = frame.bits == 64;
+        auto sent     = key_test ? ++m_tests.sent : 0;
+        auto answer   = m_tag.transceive(frame);
+        if (key_test) {
+            if (m_fail_on_key) throw std::runtime_error("Reader unplugged.");
+            m_tests.found_at = sent;
+        }
+        return answer;
+    }
+
+private:
+    Transport&        m_tag;
+    KeyTests&         m_tests;
+    bool              m_fail_on_key;
+    std::atomic<bool> m_unplugged{};
+};
+
+// A helper reader with its own copy of the tag.
+struct Helper {
+    SimulatedTag           tag;
+    ReaderProbe            probe;
+    MifareClassicInitiator initiator;
+
+    Helper(const SimulatedTagConfig& config, KeyTests& tests, bool fail_on_key)
+    : tag(config),
+      probe(tag, tests, fail_on_key),
+      initiator(probe) {}
+
+    CandidateReader reader() {
+        auto card = initiator.select_card();
+        CHECK(card);
+        return {&initiator, *card};
+    }
+};
+
+} // namespace
+
+TEST_CASE(extra_nonces_rule_out_wrong_candidates) {
+    SimulatedTag tag({.keys = {{1, target_key, std::nullopt}}});
+    MifareClassicInitiator initiator(tag);
+
+    auto card = initiator.select_card();
+    CHECK(card);
+
+    StaticNestedOptions options{.extra_nonces = 1};
+
+    auto nt_encs = capture(
+        initiator,
+        *card,
+        0,
+        MifareKey::A,
+        default_key,
+        4,
+        MifareKey::A,
+        calibration,
+        options
+    );
+    CHECK(nt_encs.size() == 3);
+
+    auto keys = recover_candidates(std::span(nt_encs).first<2>(), card->nuid)
+              | std::views::transform([](std::uint64_t state) {
+                    return Crypto1State::unpack(state).lfsr();
+                })
+              | std::ranges::to<std::vector>();
+    CHECK(std::ranges::contains(keys, target_key));
+
+    // Only the real key produces the keystream of the third nonce.
+    auto extra = std::span(nt_encs).subspan(2);
+    for (auto key : keys) {
+        CHECK(verify_key(key, extra, card->nuid) == (key == target_key));
+    }
+
+    auto filtered = recover_filtered_candidates(nt_encs, card->nuid, options);
+    CHECK(filtered);
+    CHECK(*filtered == std::vector{target_key});
+}
+
+TEST_CASE(execute_recovers_the_key_of_a_simulated_tag) {
+    SimulatedTag tag({.keys = {{1, default_key, target_key}}});
+    MifareClassicInitiator initiator(tag);
+
+    auto card = initiator.select_card();
+    CHECK(card);
+
+    auto result = execute(
+        initiator,
+        *card,
+        0,
+        MifareKey::A,
+        default_key,
+        4,
+        MifareKey::B,
+        calibration
+    );
+    CHECK(result.success);
+    CHECK(result.key == target_key);
+}
+
+TEST_CASE(helpers_stop_at_the_first_key) {
+    SimulatedTagConfig config{.keys = {{1, default_key, target_key}}};
+    KeyTests           tests;
+
+    SimulatedTag           tag(config);
+    ReaderProbe            probe(tag, tests);
+    MifareClassicInitiator initiator(probe);
+    auto                   card = initiator.select_card();
+    CHECK(card);
+
+    std::deque<Helper>           helpers;
+    std::vector<CandidateReader> readers;
+    for (auto i = 0; i < 2; i++) {
+        readers.push_back(helpers.emplace_back(config, tests, false).reader());
+    }
+
+    auto result = execute(
+        initiator,
+        *card,
+        0,
+        MifareKey::A,
+        default_key,
+        4,
+        MifareKey::B,
+        calibration,
+        {.helpers = readers}
+    );
+    CHECK(result.success);
+    CHECK(result.key == target_key);
+    // At most the key each other reader was testing at the time.
+    CHECK(tests.found_at);
+    CHECK(tests.sent - tests.found_at <= readers.size());
+}
+
+TEST_CASE(key_of_a_dropped_helper_is_tested_again) {
+    SimulatedTagConfig config{.keys = {{1, default_key, target_key}}};
+    KeyTests           tests;
+
+    SimulatedTag           tag(config);
+    ReaderProbe            probe(tag, tests);
+    MifareClassicInitiator initiator(probe);
+    auto                   card = initiator.select_card();
+    CHECK(card);
+
+    // Both helpers drop out when they get the real key, which is the only
+    // candidate left with the extra nonce. Only the main reader can find it,
+    // from the keys handed back if a helper took it first.
+    std::deque<Helper>           helpers;
+    std::vector<CandidateReader> readers;
+    for (auto i = 0; i < 2; i++) {
+        readers.push_back(helpers.emplace_back(config, tests, true).reader());
+    }
+
+    for (auto i = 0; i < 8; i++) {
+        auto result = execute(
+            initiator,
+            *card,
+            0,
+            MifareKey::A,
+            default_key,
+            4,
+            MifareKey::B,
+            calibration,
+            {.extra_nonces = 1, .helpers = readers}
+        );
+        CHECK(result.success);
+        CHECK(result.key == target_key);
+    }
+}
+
+TEST_CASE(sweep_fails_once_every_reader_failed) {
+    SimulatedTagConfig config{.keys = {{1, default_key, target_key}}};
+    KeyTests           tests;
+
+    SimulatedTag           tag(config);
+    ReaderProbe            probe(tag, tests);
+    MifareClassicInitiator initiator(probe);
+    auto                   card = initiator.select_card();
+    CHECK(card);
+
+    std::deque<Helper>           helpers;
+    std::vector<CandidateReader> readers;
+    for (auto i = 0; i < 2; i++) {
+        readers.push_back(helpers.emplace_back(config, tests, false).reader());
+    }
+
+    StaticNestedOptions options{.helpers = readers};
+
+    auto nt_encs = capture(
+        initiator,
+        *card,
+        0,
+        MifareKey::A,
+        default_key,
+        4,
+        MifareKey::B,
+        calibration,
+        options
+    );
+    // The capture authenticated with the known key already.
+    tests.found_at = 0;
+    probe.unplug();
+    for (auto& helper : helpers) {
+        helper.probe.unplug();
+    }
+
+    auto thrown = false;
+    try {
+        execute(
+            initiator,
+            *card,
+            0,
+            MifareKey::A,
+            default_key,
+            4,
+            MifareKey::B,
+            calibration,
+            options,
+            nt_encs
+        );
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(!tests.found_at);
+}
@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include <fstream>
+
+#include "tests/test.h"
+
+#include "common/sweep_checkpoint.h"
+
+using namespace nfcpp;
+using namespace nfcpp::static_nested;
+
+namespace {
+
+const ISO14443ACard card{
+    .atqa = {0x04, 0x00},
+    .uid  = {0x01, 0x02, 0x03, 0x04},
+    .nuid = 0x01020304,
+    .sak  = 0x08,
+};
+
+SweepProgress started_sweep() {
+    SweepProgress ret;
+    ret.nt_encs    = {
+        {0x01200145, 0x8DA7B3C1, 0x5},
+        {0x2B2A4EF1, 0x0F7E66A2, {}},
+    };
+    ret.candidates = {0xA0A1A2A3A4A5, 0xFFFFFFFFFFFF};
+    ret.tested     = 1;
+    return ret;
+}
+
+} // namespace
+
+TEST_CASE(sweep_checkpoint_resumes_extended_sweep) {
+    test::TempPath path("nfcpp-test-sweep.ckpt");
+    {
+        SweepCheckpoint checkpoint(path.get());
+        checkpoint.update(card, 4, mifare::MifareKey::A, started_sweep());
+        std::vector<std::uint64_t> added{0x000000000000, 0xD3F7D3F7D3F7};
+        checkpoint.extend(card, 4, mifare::MifareKey::A, added, 3, true);
+        checkpoint.update(card, 8, mifare::MifareKey::B, started_sweep());
+        checkpoint.erase(card, 8, mifare::MifareKey::B);
+    }
+
+    SweepCheckpoint checkpoint(path.get());
+    auto            resumed = checkpoint.find(card, 4, mifare::MifareKey::A);
+    CHECK(resumed);
+    CHECK(resumed->nt_encs.size() == 2);
+    CHECK(resumed->nt_encs[0].keystream == 0x8DA7B3C1);
+    CHECK(resumed->nt_encs[0].parity == 0x5);
+    CHECK(!resumed->nt_encs[1].parity);
+    CHECK(
+        resumed->candidates
+        == std::vector<std::uint64_t>{
+            0xA0A1A2A3A4A5,
+            0xFFFFFFFFFFFF,
+            0x000000000000,
+            0xD3F7D3F7D3F7
+        }
+    );
+    CHECK(resumed->tested == 3);
+    CHECK(resumed->complete);
+    CHECK(!checkpoint.find(card, 8, mifare::MifareKey::B));
+}
+
+TEST_CASE(sweep_checkpoint_only_appends_progress) {
+    test::TempPath path("nfcpp-test-sweep.ckpt");
+    SweepCheckpoint checkpoint(path.get());
+    checkpoint.update(card, 4, mifare::MifareKey::A, started_sweep());
+    auto size = std::filesystem::file_size(path.get());
+
+    // The candidates are not written again, nor is an unchanged sweep.
+    checkpoint.extend(card, 4, mifare::MifareKey::A, {}, 2, false);
+    auto grown = std::filesystem::file_size(path.get()) - size;
+    CHECK(grown < 6 * started_sweep().candidates.size() + 32);
+    checkpoint.extend(card, 4, mifare::MifareKey::A, {}, 2, false);
+    CHECK(std::filesystem::file_size(path.get()) == size + grown);
+}
+
+TEST_CASE(sweep_checkpoint_drops_torn_entry) {
+    test::TempPath path("nfcpp-test-sweep.ckpt");
+    {
+        SweepCheckpoint checkpoint(path.get());
+        checkpoint.update(card, 4, mifare::MifareKey::A, started_sweep());
+        checkpoint.extend(card, 4, mifare::MifareKey::A, {}, 2, false);
+    }
+    // The first bytes of another tested entry, cut off by a crash.
+    {
+        std::ofstream ofs(path.get(), std::ios::binary | std::ios::app);
+        ofs.write("\x10\x00\x00\x00\x02\x04", 6);
+    }
+
+    SweepCheckpoint checkpoint(path.get());
+    auto            resumed = checkpoint.find(card, 4, mifare::MifareKey::A);
+    CHECK(resumed);
+    CHECK(resumed->candidates.size() == 2);
+    CHECK(resumed->tested == 2);
+}
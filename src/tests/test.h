@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <format>
+#include <source_location>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace nfcpp::test {
+
+struct TestCase {
+    std::string_view name;
+    void (*fn)();
+};
+
+// Every TEST_CASE adds itself here before main() runs them.
+inline std::vector<TestCase>& test_cases() {
+    static std::vector<TestCase> ret;
+    return ret;
+}
+
+struct Registrar {
+    Registrar(std::string_view name, void (*fn)()) {
+        test_cases().emplace_back(name, fn);
+    }
+};
+
+class CheckFailed : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+inline void check(
+    bool                 ok,
+    std::string_view     expr,
+    std::source_location where = std::source_location::current()
+) {
+    if (ok) return;
+    throw CheckFailed(
+        std::format("{}:{}: CHECK({})", where.file_name(), where.line(), expr)
+    );
+}
+
+// A file or directory in the temp directory, gone before and after the test.
+class TempPath {
+public:
+    explicit TempPath(std::string_view name)
+    : m_path(std::filesystem::temp_directory_path() / name) {
+        std::filesystem::remove_all(m_path);
+    }
+
+    ~TempPath() { std::filesystem::remove_all(m_path); }
+
+    const std::filesystem::path& get() const { return m_path; }
+
+private:
+    std::filesystem::path m_path;
+};
+
+} // namespace nfcpp::test
+
+#define TEST_CASE(name)                                                        \
+    static void name();                                                        \
+    static const nfcpp::test::Registrar name##_registrar(#name, name);         \
+    static void name()
+
+#define CHECK(...)                                                             \
+    nfcpp::test::check(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__)
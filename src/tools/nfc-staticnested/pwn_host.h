@@ -6,50 +6,161 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
 #include <set>
 
 #include <nfcpp/nfc.hpp>
 
+#include "common/candidate_cache.h"
+#include "common/event_log.h"
+#include "common/key_cache.h"
+#include "common/key_dictionary.h"
 #include "common/mifare_initiator.h"
+#include "common/site_keychain.h"
+#include "common/sweep_checkpoint.h"
+#include "common/tag_emulator.h"
 #include "types.h"
 
 namespace nfcpp {
 
 struct InputArguments {
-    std::string                      connstring;
-    mifare::MifareCard               type;
-    bool                             force_detect_distance;
-    std::string                      dump_keys;
-    std::string                      dump;
-    bool                             no_default_keys;
-    std::vector<std::uint64_t>       user_keys;
-    std::optional<std::uint8_t>      target_sector;
-    std::optional<mifare::MifareKey> target_key_type;
+    std::string                               connstring;
+    mifare::MifareCard                        type;
+    bool                                      force_detect_distance;
+    std::size_t                               threads;
+    std::size_t                               extra_nonces;
+    std::size_t                               calibration_samples;
+    std::size_t                               max_candidates;
+    std::size_t                               max_retries;
+    std::size_t                               reacquire_timeout;
+    bool                                      batch;
+    std::string                               dump_keys;
+    std::string                               dump;
+    bool                                      no_default_keys;
+    std::vector<std::uint64_t>                user_keys;
+    std::vector<std::string>                  dictionaries;
+    std::optional<std::string>                dictionary_export;
+    std::optional<std::uint8_t>               target_sector;
+    std::optional<mifare::MifareKey>          target_key_type;
+    std::optional<mifare::SimulatedTagConfig> simulated_tag;
+    std::string                               record_trace;
+    std::string                               replay_trace;
+    bool                                      replay_paced;
+    std::string                               events;
+    bool                                      frame_stats;
+    std::string                               checkpoint;
+    std::string                               key_cache;
+    std::string                               candidate_cache;
+    std::string                               site_keys;
+    std::vector<std::string>                  helper_readers;
+    std::size_t                               sim_helpers;
+    std::string                               serve;
 };
 
+// Makes SIGUSR1 print the frame stats of the running attack, called once by
+// main() as no run restores the handler. Does nothing without SIGUSR1.
+void install_frame_stats_signal();
+
 class PwnHost {
 public:
-    PwnHost(NfcDevice::Initiator& initiator, const InputArguments& args)
-    : m_initiator(initiator),
-      m_args(args) {}
+    // The helpers hold copies of the tag and only test candidate keys.
+    // Progress events go to events if given, otherwise to args.events.
+    PwnHost(
+        mifare::Transport&                  transport,
+        const InputArguments&               args,
+        std::span<mifare::Transport* const> helpers = {},
+        util::EventLog*                     events  = nullptr
+    )
+    : m_initiator(transport),
+      m_args(args),
+      m_events(events) {
+        if (!m_events && !args.events.empty()) {
+            m_event_file = std::make_unique<util::EventLog>(args.events);
+            m_events     = m_event_file.get();
+        }
+        auto setup = [&](mifare::MifareClassicInitiator& initiator) {
+            initiator.set_events(m_events);
+            initiator.set_reacquire_timeout(
+                std::chrono::seconds(args.reacquire_timeout)
+            );
+            if (args.frame_stats) {
+                initiator.set_frame_stats(&m_frame_stats);
+            }
+        };
+        setup(m_initiator);
+        for (auto helper : helpers) {
+            setup(*m_helper_initiators.emplace_back(
+                std::make_unique<mifare::MifareClassicInitiator>(*helper)
+            ));
+        }
+        if (!args.checkpoint.empty()) {
+            m_checkpoint = std::make_unique<static_nested::SweepCheckpoint>(
+                args.checkpoint
+            );
+        }
+        if (!args.candidate_cache.empty()) {
+            m_candidate_cache =
+                std::make_unique<static_nested::CandidateCache>(
+                    args.candidate_cache
+                );
+        }
+        if (!args.key_cache.empty()) {
+            m_key_cache = std::make_unique<mifare::KeyCache>(args.key_cache);
+        }
+        if (!args.site_keys.empty()) {
+            m_site_keys =
+                std::make_unique<mifare::SiteKeychain>(args.site_keys);
+        }
+    }
 
     void run();
 
 private:
+    void load_dictionary();
+
     void discover_tag();
 
     void prepare();
 
+    void test_cached_keys(std::vector<SectorKey>& sectors);
+
+    bool has_static_nonce();
+
     void test_static_nonce();
 
+    void calibrate_nonce_distance();
+
+    std::span<const EncryptedNonce>
+    captured_nonces(std::uint8_t sector, mifare::MifareKey key_type);
+
+    void check_dictionary_offline();
+
     bool check_fm11rf08s_backdoor();
 
     void perform(std::uint8_t target_sector, mifare::MifareKey target_key_type);
 
+    void perform_batched();
+
+    StaticNestedOptions attack_options() const;
+
+    void on_sector_cracked(
+        std::uint8_t              target_sector,
+        mifare::MifareKey         target_key_type,
+        const StaticNestedResult& result
+    );
+
     void on_new_key(std::uint64_t key);
 
     void on_key_a_found(std::uint8_t sector, std::uint64_t key);
 
+    void report_key(
+        std::uint8_t      sector,
+        mifare::MifareKey key_type,
+        std::uint64_t     key,
+        std::string_view  source
+    );
+
     std::optional<std::uint64_t>
     try_read_key_b(std::uint64_t key_a, std::uint8_t sector);
 
@@ -57,6 +168,12 @@ private:
 
     void dump();
 
+    // Whether a capture may rule a key out without the reader: the distance
+    // is stable and a key found already matched its capture.
+    bool trust_captures() const {
+        return m_calibration.confidence >= 0.5 && m_captures_confirmed;
+    }
+
     bool no_unknown_keys() const {
         return m_sectors_unknown_key_a.empty()
             && m_sectors_unknown_key_b.empty();
@@ -64,9 +181,19 @@ private:
 
 private:
     // Input
-    mifare::MifareClassicInitiator m_initiator;
-    ISO14443ACard                  m_card;
-    InputArguments const&          m_args;
+    mifare::MifareClassicInitiator                  m_initiator;
+    ISO14443ACard                                   m_card;
+    InputArguments const&                           m_args;
+    std::unique_ptr<util::EventLog>                 m_event_file;
+    util::EventLog*                                 m_events;
+    mifare::FrameStats                              m_frame_stats;
+    std::unique_ptr<static_nested::SweepCheckpoint> m_checkpoint;
+    std::unique_ptr<static_nested::CandidateCache>  m_candidate_cache;
+    std::unique_ptr<mifare::KeyCache>               m_key_cache;
+    std::unique_ptr<mifare::SiteKeychain>           m_site_keys;
+    std::vector<std::unique_ptr<mifare::MifareClassicInitiator>>
+                                 m_helper_initiators;
+    std::vector<CandidateReader> m_helpers;
 
     // Context
     struct {
@@ -74,9 +201,20 @@ private:
         std::uint64_t     key;
         std::uint8_t      block;
     } m_valid_key;
+    bool                    m_static_nonce{};
+    NonceCalibration        m_calibration;
+    mifare::KeyDictionary   m_dictionary;
     std::set<std::uint64_t> m_keychain;
     std::set<std::uint8_t>  m_sectors_unknown_key_a;
     std::set<std::uint8_t>  m_sectors_unknown_key_b;
+
+    // Nonces of the unknown keys, captured at most once per key.
+    std::map<
+        std::pair<std::uint8_t, mifare::MifareKey>,
+        std::vector<EncryptedNonce>>
+        m_captures;
+    // Whether a key found matched its capture, see trust_captures().
+    bool m_captures_confirmed{};
 };
 
 } // namespace nfcpp
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#include "pwn_service.h"
+
+#include "utility.h"
+
+#include <algorithm>
+#include <array>
+#include <print>
+#include <sstream>
+#include <thread>
+
+namespace nfcpp {
+
+using namespace mifare;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Between two looks for a tag, short next to an attack.
+constexpr auto poll_interval = 200ms;
+
+// They would print and exit the whole service.
+constexpr std::array<std::string_view, 4> exiting_options{
+    "-h",
+    "--help",
+    "-v",
+    "--version",
+};
+
+// The readers are the service's, opened once when it started.
+constexpr std::array<std::string_view, 13> reader_options{
+    "-c",
+    "--connstring",
+    "--helper-reader",
+    "--serve",
+    "--record-trace",
+    "--replay-trace",
+    "--replay-paced",
+    "--simulate",
+    "--sim-key",
+    "--sim-nonce",
+    "--sim-helpers",
+    "--sim-latency",
+    "--sim-timeout",
+};
+
+} // namespace
+
+void PwnService::run() {
+    util::LocalServer server(m_args.serve);
+    std::println("Waiting for jobs on {}...", m_args.serve);
+    while (true) {
+        auto client = server.accept();
+        serve(client);
+    }
+}
+
+void PwnService::serve(util::LocalConnection& client) {
+    // A client that is gone only misses the rest of the events.
+    util::EventLog events([&](std::string_view line) { client.write(line); });
+    while (auto line = client.read_line()) {
+        run_job(*line, events);
+    }
+}
+
+void PwnService::run_job(std::string_view line, util::EventLog& events) {
+    auto job = ++m_jobs;
+    util::emit_event(&events, "job_start", {{"job", job}});
+
+    std::optional<ISO14443ACard> card;
+    try {
+        auto args = parse_job(line);
+        card      = wait_for_tag(events);
+        PwnHost(m_transport, args, m_helpers, &events).run();
+        util::emit_event(
+            &events,
+            "job_done",
+            {{"job", job}, {"success", true}}
+        );
+    } catch (const std::exception& e) {
+        std::println("Job {} failed: {}", job, e.what());
+        util::emit_event(
+            &events,
+            "job_done",
+            {{"job", job}, {"success", false}, {"error", e.what()}}
+        );
+    }
+
+    if (card) wait_for_removal(*card);
+}
+
+InputArguments PwnService::parse_job(std::string_view line) const {
+    std::vector<std::string> arguments{"nfc-staticnested"};
+    std::istringstream       iss{std::string(line)};
+    for (std::string word; iss >> word;) {
+        auto option = std::string_view(word).substr(0, word.find('='));
+        if (std::ranges::contains(exiting_options, option)) {
+            throw std::runtime_error(
+                std::format("{} is not available in a job.", option)
+            );
+        }
+        if (std::ranges::contains(reader_options, option)) {
+            throw std::runtime_error(std::format(
+                "{} is not available in a job, the readers are the "
+                "service's.",
+                option
+            ));
+        }
+        arguments.push_back(std::move(word));
+    }
+    return m_parse_args(arguments);
+}
+
+ISO14443ACard PwnService::wait_for_tag(util::EventLog& events) {
+    auto waiting = false;
+    while (true) {
+        if (auto card = m_initiator.select_card()) return *card;
+        if (!std::exchange(waiting, true)) {
+            std::println("Waiting for a tag...");
+            util::emit_event(&events, "tag_waiting");
+        }
+        std::this_thread::sleep_for(poll_interval);
+    }
+}
+
+void PwnService::wait_for_removal(const ISO14443ACard& card) {
+    // A simulated tag never leaves.
+    if (m_args.simulated_tag) return;
+
+    std::println("Take the tag away for the next job.");
+    while (m_initiator.select_card(card.uid)) {
+        std::this_thread::sleep_for(poll_interval);
+    }
+}
+
+} // namespace nfcpp
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (C) 2026-present, RedbeanW.
+ * This file is part of the NFC++ open source project.
+ */
+
+#pragma once
+
+#include <functional>
+
+#include "common/local_socket.h"
+
+#include "pwn_host.h"
+
+namespace nfcpp {
+
+// Keeps the reader open and runs a PwnHost for every job that comes in over
+// the UNIX socket at args.serve, one connection at a time.
+//
+// A job is a line of options for the next tag, as on the command line, e.g.
+// "--dump-keys 0042.keys -k A0A1A2A3A4A5". The reader options are the
+// service's own, a job that sets one fails with a job_done error and does
+// not run. Every job waits for a tag, is answered with the progress events
+// of its run and ends with a job_done event, after which the tag has to be
+// taken away before the next job starts.
+class PwnService {
+public:
+    using ArgumentParser =
+        std::function<InputArguments(const std::vector<std::string>&)>;
+
+    PwnService(
+        mifare::Transport&                  transport,
+        const InputArguments&               args,
+        std::span<mifare::Transport* const> helpers,
+        ArgumentParser                      parse_args
+    )
+    : m_transport(transport),
+      m_initiator(transport),
+      m_args(args),
+      m_helpers(helpers),
+      m_parse_args(std::move(parse_args)) {}
+
+    [[noreturn]] void run();
+
+private:
+    void serve(util::LocalConnection& client);
+
+    void run_job(std::string_view line, util::EventLog& events);
+
+    InputArguments parse_job(std::string_view line) const;
+
+    ISO14443ACard wait_for_tag(util::EventLog& events);
+
+    void wait_for_removal(const ISO14443ACard& card);
+
+private:
+    mifare::Transport&                  m_transport;
+    mifare::MifareClassicInitiator      m_initiator;
+    InputArguments const&               m_args;
+    std::span<mifare::Transport* const> m_helpers;
+    ArgumentParser                      m_parse_args;
+    std::size_t                         m_jobs{};
+};
+
+} // namespace nfcpp
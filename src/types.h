@@ -10,10 +10,24 @@
 #include <chrono>
 #include <cstdint>
 #include <optional>
+#include <span>
 #include <vector>
 
 namespace nfcpp {
 
+namespace util {
+
+class EventLog;
+
+} // namespace util
+
+namespace static_nested {
+
+class CandidateCache;
+class SweepCheckpoint;
+
+} // namespace static_nested
+
 namespace mifare {
 
 enum class MifareKey {
@@ -29,6 +43,9 @@ enum class MifareCard {
     Classic4K,
 };
 
+class KeyDictionary;
+class MifareClassicInitiator;
+
 } // namespace mifare
 
 struct ISO14443ACard {
@@ -40,6 +57,10 @@ struct ISO14443ACard {
 
 struct EncryptedNonce {
     std::uint32_t nonce, keystream;
+    // Parity bits as received (still encrypted), bit i belongs to byte i.
+    std::optional<std::uint8_t> parity;
+
+    bool operator==(const EncryptedNonce&) const = default;
 };
 
 struct SectorKey {
@@ -48,6 +69,46 @@ struct SectorKey {
     std::optional<std::uint64_t> key_b;
 };
 
+// PRNG distance between the first nonce of an auth chain and the nonce after
+// i + 1 nested auths, in distances[i].
+struct NonceCalibration {
+    std::vector<std::uint32_t> distances;
+    // Share of the samples that agree with the chosen distances, 0..1.
+    double      confidence;
+    std::size_t samples;
+    // The other distances seen at each depth, most frequent first, which the
+    // retries of a capture step through.
+    std::vector<std::vector<std::uint32_t>> alternatives;
+};
+
+// Another reader with a copy of the tag, i.e. the same keys, which tests
+// candidate keys alongside the main one.
+struct CandidateReader {
+    mifare::MifareClassicInitiator* initiator;
+    ISO14443ACard                   card;
+};
+
+struct StaticNestedOptions {
+    bool        force_detect_distance = false;
+    std::size_t threads               = 0; // 0 = all hardware threads
+    std::size_t extra_nonces          = 0;
+    // A larger candidate set means a bad capture, 0 = no limit.
+    std::size_t max_candidates = 1uz << 16;
+    // Times the nonces are collected again after a bad capture.
+    std::size_t max_retries = 3;
+    // Progress events, if not null.
+    util::EventLog* events = nullptr;
+    // Where execute() keeps its sweeps to resume them, if not null.
+    static_nested::SweepCheckpoint* checkpoint = nullptr;
+    // Where the offline phase keeps its candidates to skip them, if not null.
+    static_nested::CandidateCache* candidate_cache = nullptr;
+    // Keys matched offline against every new capture of execute(), which
+    // are tested on air before its candidates, if not null.
+    const mifare::KeyDictionary* dictionary = nullptr;
+    // Readers that share the candidate sweeps, besides the main one.
+    std::span<const CandidateReader> helpers;
+};
+
 struct StaticNestedResult {
     bool                 success;
     std::uint64_t        key;
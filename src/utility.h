@@ -8,7 +8,14 @@
 
 #include "types.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <exception>
+#include <mutex>
+#include <ranges>
+#include <thread>
+#include <vector>
 
 namespace nfcpp {
 
@@ -27,6 +34,51 @@ constexpr auto format_duration(auto duration) {
     return ret;
 };
 
+inline std::size_t resolve_threads(std::size_t threads) {
+    if (threads > 0) return threads;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Calls fn(begin, end) on chunks of [0, count) from a pool of workers, chunks
+// are handed out dynamically so uneven workloads are still balanced. The first
+// exception thrown by fn stops the handing out and is rethrown here once every
+// worker is done.
+template <typename Fn>
+void parallel_for(
+    std::size_t count,
+    std::size_t threads,
+    std::size_t grain,
+    Fn&&        fn
+) {
+    std::atomic<std::size_t> next{};
+    std::exception_ptr       error;
+    std::mutex               error_mutex;
+
+    auto worker = [&] {
+        try {
+            while (true) {
+                auto begin = next.fetch_add(grain, std::memory_order_relaxed);
+                if (begin >= count) break;
+                fn(begin, std::min(begin + grain, count));
+            }
+        } catch (...) {
+            next.store(count, std::memory_order_relaxed);
+            std::scoped_lock lock(error_mutex);
+            if (!error) error = std::current_exception();
+        }
+    };
+
+    auto workers = std::min(threads, (count + grain - 1) / grain);
+    {
+        std::vector<std::jthread> pool;
+        for (auto i = 1uz; i < workers; i++) {
+            pool.emplace_back(worker);
+        }
+        worker();
+    }
+    if (error) std::rethrow_exception(error);
+}
+
 } // namespace util
 
 namespace mifare {
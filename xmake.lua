@@ -64,6 +64,42 @@ target('nfc-isen')
     )
     add_deps('platform_workarounds')
 
+target('bench')
+    set_kind('binary')
+    set_default(false)
+    add_includedirs('src')
+    add_packages(
+        'argparse',
+        'nfcpp'
+    )
+    add_files(
+        'src/common/event_log.cpp',
+        'src/common/frame_stats.cpp',
+        'src/common/key_dictionary.cpp',
+        'src/common/mapped_file.cpp',
+        'src/common/mifare_initiator.cpp',
+        'src/common/mifare_key_tester.cpp',
+        'src/common/static_nested_solver.cpp',
+        'src/common/tag_emulator.cpp',
+        'src/common/transport.cpp',
+        'src/bench/*.cpp'
+    )
+    if is_plat('mingw', 'windows') then
+        add_syslinks('psapi')
+    end
+    add_deps('platform_workarounds')
+
+target('tests')
+    set_kind('binary')
+    set_default(false)
+    add_includedirs('src')
+    add_packages('nfcpp')
+    add_files(
+        'src/common/*.cpp',
+        'src/tests/*.cpp'
+    )
+    add_deps('platform_workarounds')
+
 package('nfcpp', function ()
     if has_config('nfcpp-source') then
         set_sourcedir(get_config('nfcpp-source'))